@@ -0,0 +1,302 @@
+#include "graph.hpp"
+#include <chrono>
+#include <random>
+#include <string.h>
+
+// Benchmark comparing build time of add_edge() against add_edges() and
+// against producers on every hardware thread feeding a graph_builder,
+// traversal speed (edges per second) of the vector-of-vectors adjacency
+// list against the frozen CSR snapshot, in the original node order and
+// renumbered by reverse Cuthill-McKee, the throughput of batched
+// point-to-point queries on one thread against all hardware threads, and
+// the distances from a sample of sources with one BFS per source against
+// one multi-source BFS.
+// It also counts the allocations made while building the adjacency list
+// edge by edge, and times freeing it, with the graph on the default heap
+// and on a std::pmr::monotonic_buffer_resource arena.
+//
+// Usage: benchmark [nodes] [edges per node] [repetitions] [queries] [sources]
+
+
+
+// Graph<T> is abstract, so the benchmark needs a small concrete graph
+class bench_graph : public Graph<int> {
+public:
+	bench_graph(std::pmr::memory_resource* resource = std::pmr::get_default_resource()) : Graph<int>(resource) {}
+
+	void load_graph() {}
+
+	graph_path run_algorithm(unsigned int, unsigned int) { return graph_path(); }
+};
+
+
+
+// Memory resource counting the allocations it passes on to 'upstream'
+class counting_resource : public std::pmr::memory_resource {
+public:
+	counting_resource(std::pmr::memory_resource* in_upstream) : upstream(in_upstream), allocations(0), bytes(0) {}
+
+	std::pmr::memory_resource* upstream;
+	unsigned long long allocations;
+	unsigned long long bytes;
+
+private:
+	void* do_allocate(std::size_t size, std::size_t alignment) {
+		this->allocations++;
+		this->bytes += size;
+		return this->upstream->allocate(size, alignment);
+	}
+
+	void do_deallocate(void* p, std::size_t size, std::size_t alignment) {
+		this->upstream->deallocate(p, size, alignment);
+	}
+
+	bool do_is_equal(const std::pmr::memory_resource& other) const noexcept { return this == &other; }
+};
+
+
+
+// Build a graph edge by edge with its adjacency list on 'resource', then
+// free it, and report the allocations that reached the heap
+void time_allocations(const char* name, const std::vector<Edge<int>>& edges, bool arena) {
+	counting_resource heap(std::pmr::new_delete_resource());
+	std::chrono::duration<double> build_time;
+	std::chrono::duration<double> free_time;
+	{
+		std::pmr::monotonic_buffer_resource pool(&heap);
+		std::pmr::memory_resource* resource = arena ? (std::pmr::memory_resource*)&pool : &heap;
+		std::unique_ptr<bench_graph> graph(new bench_graph(resource));
+
+		std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+		for (unsigned long long i = 0; i < edges.size(); i++) {
+			graph->add_edge(edges[i]);
+		}
+		build_time = std::chrono::steady_clock::now() - begin;
+
+		// Free the graph, and with it the arena
+		begin = std::chrono::steady_clock::now();
+		graph.reset();
+		pool.release();
+		free_time = std::chrono::steady_clock::now() - begin;
+	}
+	std::cout << name << heap.allocations << " allocations (" << heap.bytes / (1 << 20) << " MB), build " << build_time.count() << " s, free " << free_time.count() << " s" << std::endl;
+}
+
+
+
+// Breadth first sweep over every node, returns the number of edges scanned
+template <class G>
+unsigned long long sweep(const G& view, std::vector<unsigned int>& queue, std::vector<char>& visited) {
+	unsigned long long edges = 0;
+	std::fill(visited.begin(), visited.end(), 0);
+
+	for (unsigned int root = 0; root < view.node_count(); root++) {
+		if (visited[root]) {
+			continue;
+		}
+		visited[root] = 1;
+		queue.clear();
+		queue.push_back(root);
+		for (std::size_t head = 0; head < queue.size(); head++) {
+			unsigned int curr_node = queue[head];
+			for (unsigned int i = 0; i < view.degree(curr_node); i++) {
+				unsigned int next = view.neighbor(curr_node, i);
+				edges++;
+				if (!visited[next]) {
+					visited[next] = 1;
+					queue.push_back(next);
+				}
+			}
+		}
+	}
+	return edges;
+}
+
+
+
+// Breadth first search from one source, returns its distance summary
+template <class G>
+bfs_summary single_source(const G& view, unsigned int source, std::vector<unsigned int>& queue, std::vector<unsigned int>& distance) {
+	bfs_summary summary = { source, 0, 0, 0 };
+	std::fill(distance.begin(), distance.end(), NO_NODE);
+	distance[source] = 0;
+	queue.clear();
+	queue.push_back(source);
+	for (std::size_t head = 0; head < queue.size(); head++) {
+		unsigned int curr_node = queue[head];
+		summary.reached++;
+		summary.distance_sum += distance[curr_node];
+		summary.eccentricity = distance[curr_node];
+		for (unsigned int i = 0; i < view.degree(curr_node); i++) {
+			unsigned int next = view.neighbor(curr_node, i);
+			if (distance[next] == NO_NODE) {
+				distance[next] = distance[curr_node] + 1;
+				queue.push_back(next);
+			}
+		}
+	}
+	return summary;
+}
+
+
+
+// Time a batch of bidirectional BFS queries and report queries/sec
+double time_queries(bench_graph& graph, const std::vector<path_query>& queries, unsigned int threads) {
+	batch_runner runner(threads);
+	std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+	graph.run_queries(runner, queries, search_algorithm::BIDIRECTIONAL_BFS);
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+	return queries.size() / elapsed.count();
+}
+
+
+
+// Time 'reps' sweeps of the active layout and report edges/sec
+double time_layout(const bench_graph& graph, unsigned int reps) {
+	std::vector<unsigned int> queue;
+	std::vector<char> visited;
+	unsigned long long edges = 0;
+
+	std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+	for (unsigned int r = 0; r < reps; r++) {
+		edges += graph.visit_view([&](const auto& view) {
+			visited.resize(view.node_count());
+			return sweep(view, queue, visited);
+		});
+	}
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+	return edges / elapsed.count();
+}
+
+
+
+int main(int argc, char** argv) {
+	unsigned int nodes = 1 << 20;
+	unsigned int degree = 8;
+	unsigned int reps = 5;
+	unsigned int query_count = 10000;
+	unsigned int source_count = 64;
+	if (argc > 1) nodes = atoi(argv[1]);
+	if (argc > 2) degree = atoi(argv[2]);
+	if (argc > 3) reps = atoi(argv[3]);
+	if (argc > 4) query_count = atoi(argv[4]);
+	if (argc > 5) source_count = atoi(argv[5]);
+
+	// Generate random edges in random source order, so the per-node
+	// vectors grow interleaved (as they do when loading real data)
+	std::mt19937 rng(12345);
+	std::uniform_int_distribution<unsigned int> pick(0, nodes - 1);
+	std::vector<Edge<int>> edges((unsigned long long)nodes * degree);
+	for (unsigned long long i = 0; i < edges.size(); i++) {
+		edges[i].source = pick(rng);
+		edges[i].destination = pick(rng);
+		edges[i].meta_data = (int)i;
+	}
+
+	// Build once edge by edge, and once with the batch API
+	std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+	{
+		bench_graph single;
+		for (unsigned long long i = 0; i < edges.size(); i++) {
+			single.add_edge(edges[i]);
+		}
+	}
+	std::chrono::duration<double> single_time = std::chrono::steady_clock::now() - begin;
+
+	// Count the adjacency list allocations on the heap and on an arena
+	// (before the edges are moved into the batch-built graph)
+	std::cout << "Nodes: " << nodes << " Edges: " << (unsigned long long)nodes * degree << " Repetitions: " << reps << std::endl;
+	time_allocations("Heap allocations:  ", edges, false);
+	time_allocations("Arena allocations: ", edges, true);
+
+	// Build from every hardware thread at once: each thread adds its share
+	// of the edges to its own shard of a graph_builder, then the shards are
+	// merged in parallel
+	unsigned int threads = std::max(1u, std::thread::hardware_concurrency());
+	std::chrono::duration<double> produce_time;
+	std::chrono::duration<double> merge_time;
+	{
+		worker_pool pool(threads);
+		graph_builder<int> builder(pool.size());
+		begin = std::chrono::steady_clock::now();
+		pool.run([&](unsigned int producer) {
+			unsigned long long first = edges.size() * producer / pool.size();
+			unsigned long long last = edges.size() * (producer + 1) / pool.size();
+			for (unsigned long long i = first; i < last; i++) {
+				builder.add_edge(producer, edges[i]);
+			}
+		});
+		produce_time = std::chrono::steady_clock::now() - begin;
+		bench_graph concurrent;
+		begin = std::chrono::steady_clock::now();
+		concurrent.add_edges(builder, threads);
+		merge_time = std::chrono::steady_clock::now() - begin;
+	}
+
+	begin = std::chrono::steady_clock::now();
+	bench_graph graph;
+	graph.add_edges(std::move(edges));
+	std::chrono::duration<double> batch_time = std::chrono::steady_clock::now() - begin;
+
+	std::cout << "Build with add_edge:  " << single_time.count() << " s" << std::endl;
+	std::cout << "Build with add_edges: " << batch_time.count() << " s" << std::endl;
+	std::cout << "Build with graph_builder, " << threads << " threads: " << (produce_time + merge_time).count() << " s (add " << produce_time.count() << " s, merge " << merge_time.count() << " s)" << std::endl;
+
+	double list_rate = time_layout(graph, reps);
+	std::cout << "vector-of-vectors: " << list_rate / 1e6 << " M edges/sec" << std::endl;
+
+	graph.freeze();
+	double csr_rate = time_layout(graph, reps);
+	std::cout << "frozen CSR:        " << csr_rate / 1e6 << " M edges/sec" << std::endl;
+
+	std::cout << "Speedup: " << csr_rate / list_rate << "x" << std::endl;
+
+	// Renumber the nodes for locality, and freeze again in that order
+	begin = std::chrono::steady_clock::now();
+	vertex_order order;
+	graph.visit_view([&](const auto& view) { order.reverse_cuthill_mckee(view); });
+	graph.freeze(order);
+	std::chrono::duration<double> order_time = std::chrono::steady_clock::now() - begin;
+	double ordered_rate = time_layout(graph, reps);
+	std::cout << "CSR in RCM order:  " << ordered_rate / 1e6 << " M edges/sec (reordered in " << order_time.count() << " s)" << std::endl;
+	std::cout << "Speedup: " << ordered_rate / csr_rate << "x" << std::endl;
+
+	// Random point-to-point queries, answered in one batch
+	std::vector<path_query> queries(query_count);
+	for (unsigned int i = 0; i < query_count; i++) {
+		queries[i].start_node = pick(rng);
+		queries[i].end_node = pick(rng);
+	}
+	double single_rate = time_queries(graph, queries, 1);
+	double pool_rate = time_queries(graph, queries, threads);
+	std::cout << "Batched queries, 1 thread:   " << single_rate << " queries/sec" << std::endl;
+	std::cout << "Batched queries, " << threads << " threads: " << pool_rate << " queries/sec" << std::endl;
+
+	// Eccentricity and closeness of a sample of sources: one BFS per source, then all at once
+	std::vector<unsigned int> sources(source_count);
+	for (unsigned int i = 0; i < source_count; i++) {
+		sources[i] = pick(rng);
+	}
+	unsigned long long sequential_sum = 0;
+	begin = std::chrono::steady_clock::now();
+	graph.visit_view([&](const auto& view) {
+		std::vector<unsigned int> queue;
+		std::vector<unsigned int> distance(view.node_count());
+		for (unsigned int i = 0; i < source_count; i++) {
+			sequential_sum += single_source(view, graph.ordering().new_id(sources[i]), queue, distance).distance_sum;
+		}
+	});
+	std::chrono::duration<double> sequential_time = std::chrono::steady_clock::now() - begin;
+
+	unsigned long long batched_sum = 0;
+	begin = std::chrono::steady_clock::now();
+	std::vector<bfs_summary> summaries = graph.source_distances(sources, 1);
+	std::chrono::duration<double> batched_time = std::chrono::steady_clock::now() - begin;
+	for (unsigned int i = 0; i < source_count; i++) {
+		batched_sum += summaries[i].distance_sum;
+	}
+	std::cout << "BFS per source, " << source_count << " sources: " << sequential_time.count() << " s" << std::endl;
+	std::cout << "Multi-source BFS, 1 thread: " << batched_time.count() << " s" << (batched_sum == sequential_sum ? "" : " (DISTANCES DIFFER)") << std::endl;
+	std::cout << "Speedup: " << sequential_time.count() / batched_time.count() << "x" << std::endl;
+	return 0;
+}
@@ -6,6 +6,36 @@
 #include <list>
 #include <stack>
 #include <fstream>
+#include <utility>
+#include <algorithm>
+#include <iterator>
+#include <string>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <limits>
+#include <type_traits>
+#include <chrono>
+#include <cstring>
+#include <cstdint>
+#include <deque>
+#include <unordered_map>
+#include <memory_resource>
+#include <cstdlib>
+#if defined(__AVX2__) && !defined(GRAPH_NO_SIMD)
+#include <immintrin.h>
+#elif (defined(__SSE2__) || defined(_M_X64)) && !defined(GRAPH_NO_SIMD)
+#include <emmintrin.h>
+#endif
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 
 
@@ -13,148 +43,5415 @@
 template <class T>
 class Edge;
 
+// Forward declaration of the adjacency list entry class
+template <class T, bool Empty = std::is_empty<T>::value>
+class adjacency_entry;
+
+// The adjacency list of a Graph<T>: one vector of entries per node, all
+// allocated from the memory resource the graph was constructed with
+template <class T>
+using adjacency_list = std::pmr::vector<std::pmr::vector<adjacency_entry<T>>>;
+
+// Forward declaration of the concurrent builder class
+template <class T>
+class graph_builder;
+
+// Forward declaration of the CSR snapshot class
+template <class T>
+class csr_graph;
+
+// Forward declaration of the adjacency list view class
+template <class T>
+class list_view;
+
+// Forward declarations of the mapped file and graph snapshot classes
+class mapped_file;
+class snapshot_writer;
+struct snapshot_header;
+
 
 
   /////////////////////////////////////////////////////////////////////
- //                      GENERAL GRAPH CLASS                        //
+ //                SEARCH ALGORITHMS AND EDGE WEIGHTS               //
 /////////////////////////////////////////////////////////////////////
 
 
 
+// Search algorithms that run_algorithm() can be asked to use
+enum class search_algorithm { DFS, BFS, A_STAR, JPS, BIDIRECTIONAL_BFS, BIDIRECTIONAL_DIJKSTRA, DIJKSTRA };
+
+
+// Node identifier used to mean "no node" (e.g. a maze without a start character)
+const unsigned int NO_NODE = 0xFFFFFFFF;
+
+
+
+// A* heuristic for grids whose node identifiers are width * row + column:
+// the Manhattan distance from a node to the goal (0 if the width is unknown)
+struct manhattan_distance {
+	manhattan_distance(unsigned int in_width, unsigned int in_goal) : width(in_width), goal_row(in_width ? in_goal / in_width : 0), goal_col(in_width ? in_goal % in_width : 0) {}
+
+	unsigned int operator()(unsigned int node) const {
+		if (this->width == 0) {
+			return 0;
+		}
+		unsigned int row = node / this->width;
+		unsigned int col = node % this->width;
+		return (row > this->goal_row ? row - this->goal_row : this->goal_row - row) + (col > this->goal_col ? col - this->goal_col : this->goal_col - col);
+	}
+
+	unsigned int width;
+	unsigned int goal_row;
+	unsigned int goal_col;
+};
+
+
+
+// Edge weight function giving every edge a weight of 1. A weight function
+// is called with a graph view, a node and the index of one of its edges.
+struct unit_weight {
+	template <class G>
+	unsigned int operator()(const G&, unsigned int, unsigned int) const { return 1; }
+};
+
+
+
+// Weight-extractor trait: reads the weight of an edge from its metadata.
+// Arithmetic metadata is the weight itself, and any other metadata type
+// weighs 1 unless the trait is specialized for it (see T_MetaData).
+template <class T, class Enable = void>
+struct edge_weight {
+	unsigned int operator()(const T&) const { return 1; }
+};
+
 template <class T>
-class Graph {
-	/* THIS IS AN ABSTRACT BASE CLASS AND SHOULD NOT BE INSTANTIATED
-	 This class represents a general graph. This graph is implemented
-	 in an adjacency list format. This general base class is templated
-	 so that it may store metadata (commonly edge weight) of any
-	 data type, including user-defined types. The metadata type is
-	 a parameter of the class (shown as 'T' in my code). Because this
-	 base class is generalized, there are no requirements for what the
-	 metadata must be; however, if the user provides a user-defined
-	 struct or class as the template parameter, then the included
-	 print_graph() function will not work correctly. The user would
-	 need to create their own print function within the derived class.*/
+struct edge_weight<T, typename std::enable_if<std::is_arithmetic<T>::value>::type> {
+	T operator()(const T& meta) const { return meta; }
+};
+
+
+
+// Edge weight function that applies a weight-extractor trait to the
+// metadata of an edge (for views that have metadata)
+template <class Trait>
+struct meta_weight {
+	template <class G>
+	auto operator()(const G& view, unsigned int node, unsigned int i) const -> decltype(Trait()(view.meta(node, i))) {
+		return Trait()(view.meta(node, i));
+	}
+};
+
+
+
+  /////////////////////////////////////////////////////////////////////
+ //                            PATH CLASS                           //
+/////////////////////////////////////////////////////////////////////
+
+
+
+// Row and column of a cell of a maze
+struct grid_position {
+	unsigned int row;
+	unsigned int col;
+};
+
+
+
+class graph_path {
+	// This class is a path returned by the searches: the nodes from the
+	// start node to the end node, stored contiguously in one vector (an
+	// empty path means that there is no path). A path through a maze also
+	// knows the maze width, so every node can be decoded into its row and
+	// column.
 public:
-	// Default constructor and parameterized constructor
-	Graph() { this->N = 0; };
+	graph_path() { this->width = 0; }
 
-	Graph(std::vector<Edge<T>> in_vec, unsigned int size) {
-		this->adj_list.resize(size);
-		this->N = size;
-		for (unsigned int i = 0; i < in_vec.size(); i++) {
-			this->add_edge(in_vec[i]);
-		}
-	};
+	graph_path(std::vector<unsigned int> in_nodes, unsigned int in_width = 0) : nodes(std::move(in_nodes)) { this->width = in_width; }
 
+	std::size_t size() const { return this->nodes.size(); }
 
-	// Add an edge to the graph (with two additional overloads)
-	void add_edge(Edge<T> new_edge);
+	bool empty() const { return this->nodes.empty(); }
 
-	void add_edge(unsigned int source, unsigned int destination, T metadata);
+	unsigned int operator[](std::size_t i) const { return this->nodes[i]; }
 
-	void add_edge(unsigned int source, unsigned int destination);
+	unsigned int front() const { return this->nodes.front(); }
 
+	unsigned int back() const { return this->nodes.back(); }
 
-	// Scan an input file to load the graph (virtual function)
-	virtual void load_graph() = 0;
+	std::vector<unsigned int>::const_iterator begin() const { return this->nodes.begin(); }
 
+	std::vector<unsigned int>::const_iterator end() const { return this->nodes.end(); }
 
-	// Run the implemented graph search algorithm (virtual function)
-	virtual std::list<unsigned int> run_algorithm(unsigned int start_node, unsigned int end_node) = 0;
+	const unsigned int* data() const { return this->nodes.data(); }
 
+	// Width of the maze the path goes through (0 if it is not a maze path)
+	unsigned int grid_width() const { return this->width; }
 
-	// Print the graph:
-	void print_graph() {
-		for (unsigned int i = 0; i < this->adj_list.size(); i++) {
-			for (unsigned int j = 0; j < this->adj_list[i].size(); j++) {
-				std::cout << "Source: " << this->adj_list[i][j].source << " Destination: " << this->adj_list[i][j].destination << " Metadata: " << this->adj_list[i][j].meta_data << std::endl;
+	// Row and column of the i-th node (only for maze paths)
+	grid_position position(std::size_t i) const { return { this->nodes[i] / this->width, this->nodes[i] % this->width }; }
+
+private:
+	std::vector<unsigned int> nodes;
+	unsigned int width;
+};
+
+
+
+  /////////////////////////////////////////////////////////////////////
+ //                       PRIORITY QUEUE CLASSES                    //
+/////////////////////////////////////////////////////////////////////
+
+
+
+template <class K, unsigned int D = 4>
+class dary_heap {
+	// This class is an indexed D-ary min-heap of nodes keyed by K, used by
+	// Dijkstra's algorithm and D* Lite. Each node is in the heap at most
+	// once (its key is changed in place), and with four children per entry
+	// the heap is shallower than a binary heap and its children share a
+	// cache line.
+public:
+	// Empty the heap, for nodes 0 to 'nodes' - 1
+	void reset(unsigned int nodes) {
+		for (std::size_t k = 0; k < this->items.size(); k++) {
+			this->position[this->items[k].node] = NO_NODE;
+		}
+		this->items.clear();
+		if (this->position.size() < nodes) {
+			this->position.resize(nodes, NO_NODE);
+		}
+	}
+
+	bool empty() const { return this->items.empty(); }
+
+	std::size_t size() const { return this->items.size(); }
+
+	// Memory reserved by the heap
+	std::size_t reserved_bytes() const { return this->items.capacity() * sizeof(item) + this->position.capacity() * sizeof(unsigned int); }
+
+	K top_key() const { return this->items[0].key; }
+
+	// Node with the smallest key
+	unsigned int top() const { return this->items[0].node; }
+
+	bool contains(unsigned int node) const { return node < this->position.size() && this->position[node] != NO_NODE; }
+
+	// Add a node, or lower its key if it is already in the heap
+	void push(unsigned int node, K key) {
+		unsigned int k = this->position[node];
+		if (k == NO_NODE) {
+			k = (unsigned int)this->items.size();
+			this->items.push_back({ key, node });
+		}
+		else if (key < this->items[k].key) {
+			this->items[k].key = key;
+		}
+		else {
+			return;
+		}
+		this->sift_up(k);
+	}
+
+	// Give a node in the heap a new key, higher or lower
+	void update(unsigned int node, K key) {
+		unsigned int k = this->position[node];
+		bool lower = key < this->items[k].key;
+		this->items[k].key = key;
+		if (lower) {
+			this->sift_up(k);
+		}
+		else {
+			this->sift_down(k);
+		}
+	}
+
+	// Remove a node from the heap
+	void erase(unsigned int node) {
+		unsigned int k = this->position[node];
+		this->position[node] = NO_NODE;
+		item last = this->items.back();
+		this->items.pop_back();
+		if (k < this->items.size()) {
+			bool lower = last.key < this->items[k].key;
+			this->items[k] = last;
+			this->position[last.node] = k;
+			if (lower) {
+				this->sift_up(k);
+			}
+			else {
+				this->sift_down(k);
 			}
 		}
 	}
 
+	// Remove and return the node with the smallest key
+	unsigned int pop() {
+		unsigned int node = this->items[0].node;
+		this->position[node] = NO_NODE;
+		this->items[0] = this->items.back();
+		this->items.pop_back();
+		if (!this->items.empty()) {
+			this->position[this->items[0].node] = 0;
+			this->sift_down(0);
+		}
+		return node;
+	}
 
-protected:
-	// This 'adjacency list' is actually a vector of vectors, instead of
-	// the traditional array of lists. However, the funtionality is still
-	// the same, with the added benefit of it being simple and easily resizeable.
-	std::vector<std::vector<Edge<T>>> adj_list;
+private:
+	struct item {
+		K key;
+		unsigned int node;
+	};
 
+	void sift_up(unsigned int k) {
+		item moving = this->items[k];
+		while (k > 0) {
+			unsigned int up = (k - 1) / D;
+			if (!(moving.key < this->items[up].key)) {
+				break;
+			}
+			this->items[k] = this->items[up];
+			this->position[this->items[k].node] = k;
+			k = up;
+		}
+		this->items[k] = moving;
+		this->position[moving.node] = k;
+	}
 
-	// Number of nodes
-	unsigned int N;
+	void sift_down(unsigned int k) {
+		item moving = this->items[k];
+		unsigned int size = (unsigned int)this->items.size();
+		while (true) {
+			unsigned int first = k * D + 1;
+			if (first >= size) {
+				break;
+			}
+			unsigned int best = first;
+			for (unsigned int c = first + 1; c < first + D && c < size; c++) {
+				if (this->items[c].key < this->items[best].key) {
+					best = c;
+				}
+			}
+			if (!(this->items[best].key < moving.key)) {
+				break;
+			}
+			this->items[k] = this->items[best];
+			this->position[this->items[k].node] = k;
+			k = best;
+		}
+		this->items[k] = moving;
+		this->position[moving.node] = k;
+	}
+
+	std::vector<item> items;
+	// Index of every node in 'items', or NO_NODE
+	std::vector<unsigned int> position;
 };
 
 
 
-template <class T>
-void Graph<T>::add_edge(Edge<T> new_edge) {
-	// Due to the adjacency list representation, each 'node' is considered
-	// to be an integer between 0 and the length of the adjacency list. The
-	// nodes must be continuous, because we cannot leave a gap in our adjacency
-	// list, at least as it is currently implemented with vectors.
+class radix_heap {
+	// This class is a monotone priority queue for integer keys, used by
+	// Dijkstra's algorithm when the edge weights are integers. It relies on
+	// keys never being smaller than the last key popped: each entry sits
+	// in the bucket given by the highest bit in which its key differs from
+	// that last key, so a push is O(1) and an entry only moves to lower
+	// buckets, at most 64 times in total. A node can be pushed more than
+	// once; stale entries are skipped by the caller.
+public:
+	radix_heap() { this->last = 0; this->count = 0; }
 
-	// If either node is not included in the adjacency list, resize
-	while (new_edge.source >= this->N || new_edge.destination >= this->N) {
-		this->adj_list.resize(this->N + 1);
-		this->N = this->N + 1;
+	void reset() {
+		for (unsigned int b = 0; b < 65; b++) {
+			this->buckets[b].clear();
+		}
+		this->last = 0;
+		this->count = 0;
 	}
 
-	// Add the new edge
-	this->adj_list[new_edge.source].push_back(new_edge);
+	bool empty() const { return this->count == 0; }
+
+	std::size_t size() const { return this->count; }
+
+	// Memory reserved by the heap
+	std::size_t reserved_bytes() const {
+		std::size_t bytes = 0;
+		for (unsigned int b = 0; b < 65; b++) {
+			bytes += this->buckets[b].capacity() * sizeof(entry);
+		}
+		return bytes;
+	}
+
+	void push(unsigned long long key, unsigned int node) {
+		this->buckets[this->bucket(key)].push_back({ key, node });
+		this->count++;
+	}
+
+	// Remove the entry with the smallest key, returning its node and key
+	unsigned int pop(unsigned long long& key) {
+		if (this->buckets[0].empty()) {
+			// Find the first non-empty bucket and spread it over the lower ones
+			unsigned int b = 1;
+			while (this->buckets[b].empty()) {
+				b++;
+			}
+			unsigned long long smallest = this->buckets[b][0].key;
+			for (std::size_t k = 1; k < this->buckets[b].size(); k++) {
+				smallest = std::min(smallest, this->buckets[b][k].key);
+			}
+			this->last = smallest;
+			for (std::size_t k = 0; k < this->buckets[b].size(); k++) {
+				this->buckets[this->bucket(this->buckets[b][k].key)].push_back(this->buckets[b][k]);
+			}
+			this->buckets[b].clear();
+		}
+		entry top = this->buckets[0].back();
+		this->buckets[0].pop_back();
+		this->count--;
+		key = top.key;
+		return top.node;
+	}
+
+private:
+	struct entry {
+		unsigned long long key;
+		unsigned int node;
+	};
+
+	unsigned int bucket(unsigned long long key) const {
+		unsigned long long diff = key ^ this->last;
+		unsigned int b = 0;
+		while (diff != 0) {
+			diff >>= 1;
+			b++;
+		}
+		return b;
+	}
+
+	std::vector<entry> buckets[65];
+	unsigned long long last;
+	std::size_t count;
 };
 
 
 
-template <class T>
-void Graph<T>::add_edge(unsigned int source, unsigned int destination, T metadata) {
-	// If either node is not included in the adjacency list, resize
-	while (source >= this->N || destination >= this->N) {
-		this->adj_list.resize(this->N + 1);
-		this->N = this->N + 1;
+  /////////////////////////////////////////////////////////////////////
+ //                       EPOCH-STAMPED SET CLASS                   //
+/////////////////////////////////////////////////////////////////////
+
+
+
+class stamp_set {
+	// This class is a set of node ids that can be emptied in O(1). Every
+	// node has a stamp, and a node is in the set while its stamp equals
+	// the current epoch, so clear() only has to advance the epoch. The
+	// stamps are only zeroed when the epoch wraps around, once every
+	// 2^32 - 1 clears. Searches that run back to back (thousands of
+	// short queries on one large graph) therefore never pay O(V) to
+	// reset their visited sets.
+public:
+	stamp_set() { this->epoch = 1; }
+
+	// Empty the set, and make room for node ids below 'nodes'
+	void clear(unsigned int nodes) {
+		if (this->stamps.size() < nodes) {
+			this->stamps.resize(nodes, 0);
+		}
+		if (++this->epoch == 0) {
+			std::fill(this->stamps.begin(), this->stamps.end(), 0);
+			this->epoch = 1;
+		}
 	}
 
-	// Add the new edge
-	Edge<T>* temp = new Edge<T>;
-	temp->source = source;
-	temp->destination = destination;
-	temp->meta_data = metadata;
-	this->adj_list[temp->source].push_back(*temp);
+	std::size_t capacity() const { return this->stamps.size(); }
+
+	// Memory reserved by the set
+	std::size_t reserved_bytes() const { return this->stamps.capacity() * sizeof(unsigned int); }
+
+	bool contains(unsigned int node) const { return this->stamps[node] == this->epoch; }
+
+	// Add a node, returns false if it already was in the set
+	bool insert(unsigned int node) {
+		if (this->stamps[node] == this->epoch) {
+			return false;
+		}
+		this->stamps[node] = this->epoch;
+		return true;
+	}
+
+private:
+	std::vector<unsigned int> stamps;
+	unsigned int epoch;
 };
 
 
 
-template <class T>
-void Graph<T>::add_edge(unsigned int source, unsigned int destination) {
-	// If either node is not included in the adjacency list, resize
-	while (source >= this->N || destination >= this->N) {
-		this->adj_list.resize(this->N + 1);
-		this->N = this->N + 1;
+  /////////////////////////////////////////////////////////////////////
+ //                        SEARCH STATISTICS                        //
+/////////////////////////////////////////////////////////////////////
+
+
+
+// Phases that search_stats times separately
+enum class search_phase { FILE_READ, EDGE_BUILD, SEARCH, PATH_RECONSTRUCTION };
+
+
+
+// Statistics policy that records nothing. Every hook is an empty inline
+// function and its timers are empty structs, so a search engine built
+// with it compiles to exactly the uninstrumented code.
+struct no_stats {
+	// (The empty destructor only tells the compiler that an unused timer is intended)
+	struct timer {
+		~timer() {}
+	};
+
+	void expand() {}
+	void scan() {}
+	void frontier(std::size_t) {}
+	timer time(search_phase) { return timer(); }
+	template <class E>
+	timer query(const E&) { return timer(); }
+};
+
+
+
+// Statistics policy that counts the work done by the searches and times
+// their phases. The counters add up over every query until reset().
+struct search_stats {
+	// Adds the time from its creation to its destruction to one phase
+	class timer {
+	public:
+		timer(double& in_total) : total(in_total), begin(std::chrono::steady_clock::now()) {}
+
+		~timer() { this->total += std::chrono::duration<double>(std::chrono::steady_clock::now() - this->begin).count(); }
+
+	private:
+		double& total;
+		std::chrono::steady_clock::time_point begin;
+	};
+
+	// Times one whole query, and counts the scratch memory it allocated
+	template <class E>
+	class query_timer {
+	public:
+		query_timer(search_stats& in_stats, const E& in_engine) : stats(in_stats), engine(in_engine), clock(in_stats.seconds[(int)search_phase::SEARCH]) {
+			this->bytes = in_engine.reserved_bytes();
+			in_stats.queries++;
+		}
+
+		~query_timer() {
+			std::size_t after = this->engine.reserved_bytes();
+			if (after > this->bytes) {
+				this->stats.bytes_allocated += after - this->bytes;
+			}
+		}
+
+	private:
+		search_stats& stats;
+		const E& engine;
+		timer clock;
+		std::size_t bytes;
+	};
+
+	search_stats() { this->reset(); }
+
+	void reset() {
+		this->queries = 0;
+		this->nodes_expanded = 0;
+		this->edges_scanned = 0;
+		this->peak_frontier = 0;
+		this->bytes_allocated = 0;
+		for (int k = 0; k < 4; k++) {
+			this->seconds[k] = 0.0;
+		}
 	}
 
-	// Add the new edge
-	Edge<T>* temp = new Edge<T>;
-	temp->source = source;
-	temp->destination = destination;
-	this->adj_list[temp->source].push_back(*temp);
+	// A node is taken off the stack, queue or open list to be expanded
+	void expand() { this->nodes_expanded++; }
+
+	// An edge is followed
+	void scan() { this->edges_scanned++; }
+
+	// The stack, queue or open list holds 'size' entries
+	void frontier(std::size_t size) { this->peak_frontier = std::max(this->peak_frontier, (unsigned long long)size); }
+
+	timer time(search_phase phase) { return timer(this->seconds[(int)phase]); }
+
+	template <class E>
+	query_timer<E> query(const E& engine) { return query_timer<E>(*this, engine); }
+
+	// Write the statistics as a JSON object
+	void print_json(std::ostream& out) const {
+		out << "{ \"queries\": " << this->queries << ", \"nodes_expanded\": " << this->nodes_expanded;
+		out << ", \"edges_scanned\": " << this->edges_scanned << ", \"peak_frontier\": " << this->peak_frontier;
+		out << ", \"bytes_allocated\": " << this->bytes_allocated << ", \"seconds\": { \"file_read\": " << this->seconds[0];
+		out << ", \"edge_build\": " << this->seconds[1] << ", \"search\": " << this->seconds[2];
+		out << ", \"path_reconstruction\": " << this->seconds[3] << " } }";
+	}
+
+	unsigned long long queries;
+	unsigned long long nodes_expanded;
+	unsigned long long edges_scanned;
+	// Largest stack, queue or open list (both sides together for bidirectional searches)
+	unsigned long long peak_frontier;
+	// Memory the loader allocated for the graph, and the scratch memory the searches had to add
+	unsigned long long bytes_allocated;
+	// Time per phase, in seconds (indexed by search_phase). The search
+	// time includes the path reconstruction.
+	double seconds[4];
 };
 
 
 
   /////////////////////////////////////////////////////////////////////
- //                            EDGE CLASS                           //
+ //                        SEARCH ENGINE CLASS                      //
 /////////////////////////////////////////////////////////////////////
 
 
 
-template <class T>
-class Edge {
-	// This class represents the edges of the graph.
-	// As mentioned in the above class declaration, it
-	// has a template parameter that tells it what type
-	// of data to store.
+template <class Stats = no_stats>
+class basic_search_engine {
+	// This class runs non-recursive searches over any graph view (a
+	// list_view<T>, a csr_graph<T> or a grid_graph). A view may return
+	// NO_NODE from neighbor() for an edge that does not exist. The explicit stack, the queue,
+	// the visited set and the parent array are kept between searches,
+	// so repeated queries reuse the same memory instead of reallocating it,
+	// and the visited sets are epoch-stamped so a new search clears them
+	// in O(1) instead of in O(V).
+	// Every search is O(V + E) and uses no call stack, so it scales to
+	// graphs far larger than the recursion limit allows. The Stats policy
+	// (no_stats, or search_stats to count and time the work) is called at
+	// every expansion and edge; search_engine is the engine without stats.
 public:
-	int source, destination;
-	T meta_data;
+	// Depth first search. Neighbors are tried in adjacency order, exactly
+	// like a recursive DFS would, and the first path found is returned.
+	template <class G>
+	std::vector<unsigned int> DFS(const G& view, unsigned int start_node, unsigned int end_node);
+
+	// Breadth first search. The returned path has the fewest possible hops.
+	template <class G>
+	std::vector<unsigned int> BFS(const G& view, unsigned int start_node, unsigned int end_node);
+
+	// A* search with unit edge costs. 'heuristic(node)' must never
+	// overestimate the number of hops left (e.g. manhattan_distance on a
+	// grid), and then the returned path has the fewest possible hops.
+	template <class G, class H>
+	std::vector<unsigned int> A_star(const G& view, unsigned int start_node, unsigned int end_node, H heuristic);
+
+	// Jump Point Search on a uniform-cost, 4-connected grid (a grid_graph).
+	// Instead of adding every neighbor to the open list, it jumps along
+	// straight lines and only stops at cells where the shortest paths can
+	// branch, then expands the jumps back into a full, shortest path.
+	template <class G>
+	std::vector<unsigned int> JPS(const G& grid, unsigned int start_node, unsigned int end_node);
+
+	// Breadth first search from both ends at once: forward from the start
+	// over 'view', and backward from the end over 'reverse' (the incoming
+	// edges, e.g. a reverse_graph). The side with the smaller frontier
+	// expands a whole level at a time, and the search stops on the level
+	// where the two sides meet. Returns a path with the fewest hops.
+	template <class G, class R>
+	std::vector<unsigned int> bidirectional_BFS(const G& view, const R& reverse, unsigned int start_node, unsigned int end_node);
+
+	// Dijkstra's algorithm from both ends at once, with edge weights given
+	// by 'weight(view, node, i)' (which must not be negative). 'reverse'
+	// must also provide slot(node, i): the index of each incoming edge in
+	// the adjacency of its source. Stops once the smallest keys of the two
+	// sides add up to at least the best path found. Returns a shortest path.
+	template <class G, class R, class W>
+	std::vector<unsigned int> bidirectional_Dijkstra(const G& view, const R& reverse, unsigned int start_node, unsigned int end_node, W weight);
+
+	// Dijkstra's algorithm with edge weights given by 'weight(view, node, i)'
+	// (which must not be negative). Integer weights use a radix_heap, any
+	// other weights a 4-ary dary_heap. The search stops as soon as the end
+	// node is settled; pass NO_NODE as the end node to settle every node
+	// reachable from the start. Returns a shortest path.
+	template <class G, class W>
+	std::vector<unsigned int> Dijkstra(const G& view, unsigned int start_node, unsigned int end_node, W weight);
+
+	// Memory reserved by the buffers of the engine
+	std::size_t reserved_bytes() const;
+
+	// Counters and timings of the searches run so far (nothing with no_stats)
+	Stats stats;
+
+	// Length of the shortest path to a node found by the last Dijkstra()
+	// call, or infinity if the node was not reached
+	double distance_to(unsigned int node) const {
+		if (node >= this->visited.capacity() || !this->visited.contains(node)) {
+			return std::numeric_limits<double>::infinity();
+		}
+		return this->distance[node];
+	}
+
+private:
+	// Clear the visited set for a graph with 'nodes' nodes (in O(1))
+	void reset(unsigned int nodes) {
+		this->visited.clear(nodes);
+	}
+
+	// Mark a node as visited, returns false if it already was
+	bool visit(unsigned int node) {
+		return this->visited.insert(node);
+	}
+
+	// DFS stack entry: a node, and the index of the next edge to try from it
+	struct frame {
+		unsigned int node;
+		unsigned int next;
+	};
+
+	// A* / JPS open list entry, ordered by f = g + h (ties prefer the larger g)
+	struct open_entry {
+		unsigned int f;
+		unsigned int g;
+		unsigned int node;
+
+		bool operator<(const open_entry& other) const {
+			return this->f > other.f || (this->f == other.f && this->g < other.g);
+		}
+	};
+
+	// Set up the cost and parent arrays and the closed set for A* / JPS
+	void reset_informed(unsigned int nodes) {
+		this->reset(nodes);
+		this->closed.clear(nodes);
+		if (this->parent.size() < nodes) {
+			this->parent.resize(nodes);
+		}
+		if (this->cost.size() < nodes) {
+			this->cost.resize(nodes);
+		}
+		this->open.clear();
+	}
+
+	bool is_closed(unsigned int node) const {
+		return this->closed.contains(node);
+	}
+
+	// Offer a new cost for a node, and add it to the open list if it improves
+	void relax(unsigned int node, unsigned int from, unsigned int g, unsigned int h) {
+		if (this->visit(node) || g < this->cost[node]) {
+			this->cost[node] = g;
+			this->parent[node] = from;
+			this->open.push_back({ g + h, g, node });
+			std::push_heap(this->open.begin(), this->open.end());
+			this->stats.frontier(this->open.size());
+		}
+	}
+
+	// Follow the parent array back from the end node
+	void trace_path(unsigned int start_node, unsigned int end_node, std::vector<unsigned int>& path) {
+		auto timer = this->stats.time(search_phase::PATH_RECONSTRUCTION);
+		for (unsigned int node = end_node; node != start_node; node = this->parent[node]) {
+			path.push_back(node);
+		}
+		path.push_back(start_node);
+		std::reverse(path.begin(), path.end());
+	}
+
+	// Walk from (x, y) in direction (dx, dy) until reaching a jump point
+	// (returned), or a wall or the edge of the grid (NO_NODE)
+	template <class G>
+	unsigned int jump(const G& grid, int x, int y, int dx, int dy, unsigned int end_node);
+
+	std::vector<frame> stack;
+	std::vector<unsigned int> queue;
+	stamp_set visited;
+	std::vector<unsigned int> parent;
+	stamp_set closed;
+	std::vector<unsigned int> cost;
+	std::vector<open_entry> open;
+
+	// Dijkstra open list entry, ordered by distance
+	struct distance_entry {
+		double key;
+		unsigned int node;
+
+		bool operator<(const distance_entry& other) const {
+			return this->key > other.key;
+		}
+	};
+
+	// Set up both sides of a bidirectional search
+	void reset_bidirectional(unsigned int nodes) {
+		this->reset(nodes);
+		this->visited_back.clear(nodes);
+		if (this->parent.size() < nodes) {
+			this->parent.resize(nodes);
+		}
+		if (this->parent_back.size() < nodes) {
+			this->parent_back.resize(nodes);
+		}
+	}
+
+	// Join the forward search tree (start to 'meet') and the backward
+	// search tree ('meet' to end) into one path
+	void join_paths(unsigned int start_node, unsigned int meet, std::vector<unsigned int>& path) {
+		this->trace_path(start_node, meet, path);
+		auto timer = this->stats.time(search_phase::PATH_RECONSTRUCTION);
+		for (unsigned int node = meet; node != this->parent_back[node]; ) {
+			node = this->parent_back[node];
+			path.push_back(node);
+		}
+	}
+
+	// Backward side of the bidirectional searches
+	std::vector<unsigned int> queue_back;
+	stamp_set visited_back;
+	std::vector<unsigned int> parent_back;
+	std::vector<unsigned int> cost_back;
+	stamp_set closed_back;
+	std::vector<double> distance;
+	std::vector<double> distance_back;
+	std::vector<distance_entry> heap;
+	std::vector<distance_entry> heap_back;
+
+	// Dijkstra() priority queues
+	dary_heap<double> dheap;
+	radix_heap rheap;
+};
+
+
+
+// Search engine without statistics
+typedef basic_search_engine<no_stats> search_engine;
+
+
+
+template <class Stats>
+std::size_t basic_search_engine<Stats>::reserved_bytes() const {
+	std::size_t bytes = this->visited.reserved_bytes() + this->closed.reserved_bytes() + this->visited_back.reserved_bytes() + this->closed_back.reserved_bytes();
+	bytes += this->stack.capacity() * sizeof(frame) + this->open.capacity() * sizeof(open_entry);
+	bytes += (this->queue.capacity() + this->parent.capacity() + this->cost.capacity()) * sizeof(unsigned int);
+	bytes += (this->queue_back.capacity() + this->parent_back.capacity() + this->cost_back.capacity()) * sizeof(unsigned int);
+	bytes += (this->distance.capacity() + this->distance_back.capacity()) * sizeof(double);
+	bytes += (this->heap.capacity() + this->heap_back.capacity()) * sizeof(distance_entry);
+	return bytes + this->dheap.reserved_bytes() + this->rheap.reserved_bytes();
+};
+
+
+
+template <class Stats>
+template <class G>
+std::vector<unsigned int> basic_search_engine<Stats>::DFS(const G& view, unsigned int start_node, unsigned int end_node) {
+	std::vector<unsigned int> path;
+	if (start_node == end_node) {
+		path.push_back(start_node);
+		return path;
+	}
+	if (start_node >= view.node_count()) {
+		return path;
+	}
+
+	auto query = this->stats.query(*this);
+	this->reset(view.node_count());
+	this->stack.clear();
+	this->visit(start_node);
+	this->stack.push_back({ start_node, 0 });
+	this->stats.expand();
+
+	while (!this->stack.empty()) {
+		frame& top = this->stack.back();
+
+		// Every edge of this node has been tried, backtrack
+		if (top.next == view.degree(top.node)) {
+			this->stack.pop_back();
+			continue;
+		}
+
+		unsigned int next = view.neighbor(top.node, top.next);
+		top.next++;
+		this->stats.scan();
+		if (next == NO_NODE || !this->visit(next)) {
+			continue;
+		}
+		this->stack.push_back({ next, 0 });
+		this->stats.expand();
+		this->stats.frontier(this->stack.size());
+
+		// The stack holds the path from the start node to the end node
+		if (next == end_node) {
+			auto timer = this->stats.time(search_phase::PATH_RECONSTRUCTION);
+			path.reserve(this->stack.size());
+			for (unsigned int i = 0; i < this->stack.size(); i++) {
+				path.push_back(this->stack[i].node);
+			}
+			return path;
+		}
+	}
+
+	// The end node is unreachable
+	return path;
+};
+
+
+
+template <class Stats>
+template <class G>
+std::vector<unsigned int> basic_search_engine<Stats>::BFS(const G& view, unsigned int start_node, unsigned int end_node) {
+	std::vector<unsigned int> path;
+	if (start_node == end_node) {
+		path.push_back(start_node);
+		return path;
+	}
+	if (start_node >= view.node_count()) {
+		return path;
+	}
+
+	auto query = this->stats.query(*this);
+	this->reset(view.node_count());
+	if (this->parent.size() < view.node_count()) {
+		this->parent.resize(view.node_count());
+	}
+	this->queue.clear();
+	this->visit(start_node);
+	this->queue.push_back(start_node);
+
+	for (std::size_t head = 0; head < this->queue.size(); head++) {
+		unsigned int curr_node = this->queue[head];
+		this->stats.expand();
+		for (unsigned int i = 0; i < view.degree(curr_node); i++) {
+			unsigned int next = view.neighbor(curr_node, i);
+			this->stats.scan();
+			if (next == NO_NODE || !this->visit(next)) {
+				continue;
+			}
+			this->parent[next] = curr_node;
+
+			// Follow the parent array back to the start node
+			if (next == end_node) {
+				this->trace_path(start_node, end_node, path);
+				return path;
+			}
+			this->queue.push_back(next);
+			this->stats.frontier(this->queue.size() - head);
+		}
+	}
+
+	// The end node is unreachable
+	return path;
+};
+
+
+
+template <class Stats>
+template <class G, class H>
+std::vector<unsigned int> basic_search_engine<Stats>::A_star(const G& view, unsigned int start_node, unsigned int end_node, H heuristic) {
+	std::vector<unsigned int> path;
+	if (start_node == end_node) {
+		path.push_back(start_node);
+		return path;
+	}
+	if (start_node >= view.node_count()) {
+		return path;
+	}
+
+	auto query = this->stats.query(*this);
+	this->reset_informed(view.node_count());
+	this->relax(start_node, start_node, 0, heuristic(start_node));
+
+	while (!this->open.empty()) {
+		std::pop_heap(this->open.begin(), this->open.end());
+		open_entry top = this->open.back();
+		this->open.pop_back();
+
+		// Skip entries that were improved on after they were added
+		if (this->is_closed(top.node) || top.g != this->cost[top.node]) {
+			continue;
+		}
+		if (top.node == end_node) {
+			this->trace_path(start_node, end_node, path);
+			return path;
+		}
+		this->closed.insert(top.node);
+		this->stats.expand();
+
+		for (unsigned int i = 0; i < view.degree(top.node); i++) {
+			unsigned int next = view.neighbor(top.node, i);
+			this->stats.scan();
+			if (next == NO_NODE || this->is_closed(next)) {
+				continue;
+			}
+			this->relax(next, top.node, top.g + 1, heuristic(next));
+		}
+	}
+
+	// The end node is unreachable
+	return path;
+};
+
+
+
+template <class Stats>
+template <class G>
+unsigned int basic_search_engine<Stats>::jump(const G& grid, int x, int y, int dx, int dy, unsigned int end_node) {
+	int width = (int)grid.width;
+	int height = (int)grid.height;
+	auto open_at = [&](int cx, int cy) {
+		return cx >= 0 && cy >= 0 && cx < width && cy < height && grid.is_open((unsigned int)(cy * width + cx));
+	};
+
+	while (open_at(x, y)) {
+		unsigned int node = (unsigned int)(y * width + x);
+		if (node == end_node) {
+			return node;
+		}
+		if (dx != 0) {
+			// Moving horizontally: stop where a cell above or below opens up
+			if ((open_at(x, y - 1) && !open_at(x - dx, y - 1)) || (open_at(x, y + 1) && !open_at(x - dx, y + 1))) {
+				return node;
+			}
+		}
+		else {
+			// Moving vertically: stop where a cell to the side opens up, or
+			// where a horizontal jump from this cell would find a jump point
+			if ((open_at(x - 1, y) && !open_at(x - 1, y - dy)) || (open_at(x + 1, y) && !open_at(x + 1, y - dy))) {
+				return node;
+			}
+			if (this->jump(grid, x + 1, y, 1, 0, end_node) != NO_NODE || this->jump(grid, x - 1, y, -1, 0, end_node) != NO_NODE) {
+				return node;
+			}
+		}
+		x += dx;
+		y += dy;
+	}
+	return NO_NODE;
+};
+
+
+
+template <class Stats>
+template <class G>
+std::vector<unsigned int> basic_search_engine<Stats>::JPS(const G& grid, unsigned int start_node, unsigned int end_node) {
+	std::vector<unsigned int> path;
+	if (start_node == end_node) {
+		path.push_back(start_node);
+		return path;
+	}
+	if (start_node >= grid.node_count() || end_node >= grid.node_count()) {
+		return path;
+	}
+
+	int width = (int)grid.width;
+	int height = (int)grid.height;
+	auto open_at = [&](int cx, int cy) {
+		return cx >= 0 && cy >= 0 && cx < width && cy < height && grid.is_open((unsigned int)(cy * width + cx));
+	};
+	manhattan_distance heuristic(grid.width, end_node);
+
+	auto query = this->stats.query(*this);
+	this->reset_informed(grid.node_count());
+	this->relax(start_node, start_node, 0, heuristic(start_node));
+
+	while (!this->open.empty()) {
+		std::pop_heap(this->open.begin(), this->open.end());
+		open_entry top = this->open.back();
+		this->open.pop_back();
+
+		if (this->is_closed(top.node) || top.g != this->cost[top.node]) {
+			continue;
+		}
+		if (top.node == end_node) {
+			break;
+		}
+		this->closed.insert(top.node);
+		this->stats.expand();
+
+		int x = (int)(top.node % grid.width);
+		int y = (int)(top.node / grid.width);
+
+		// Directions to jump in: all four from the start, otherwise only
+		// straight on and to the sides of the direction we arrived from
+		int dirs[4][2];
+		int count = 0;
+		if (top.node == start_node) {
+			int all[4][2] = { { -1, 0 }, { 1, 0 }, { 0, -1 }, { 0, 1 } };
+			for (int k = 0; k < 4; k++) {
+				dirs[count][0] = all[k][0];
+				dirs[count++][1] = all[k][1];
+			}
+		}
+		else {
+			int px = (int)(this->parent[top.node] % grid.width);
+			int py = (int)(this->parent[top.node] / grid.width);
+			int dx = (x > px) - (x < px);
+			int dy = (y > py) - (y < py);
+			if (dx != 0) {
+				dirs[count][0] = 0; dirs[count++][1] = -1;
+				dirs[count][0] = 0; dirs[count++][1] = 1;
+				dirs[count][0] = dx; dirs[count++][1] = 0;
+			}
+			else {
+				dirs[count][0] = -1; dirs[count++][1] = 0;
+				dirs[count][0] = 1; dirs[count++][1] = 0;
+				dirs[count][0] = 0; dirs[count++][1] = dy;
+			}
+		}
+
+		for (int k = 0; k < count; k++) {
+			this->stats.scan();
+			if (!open_at(x + dirs[k][0], y + dirs[k][1])) {
+				continue;
+			}
+			unsigned int next = this->jump(grid, x + dirs[k][0], y + dirs[k][1], dirs[k][0], dirs[k][1], end_node);
+			if (next == NO_NODE || this->is_closed(next)) {
+				continue;
+			}
+			int nx = (int)(next % grid.width);
+			int ny = (int)(next / grid.width);
+			unsigned int distance = (unsigned int)(std::abs(nx - x) + std::abs(ny - y));
+			this->relax(next, top.node, top.g + distance, heuristic(next));
+		}
+	}
+
+	// The end node is unreachable if it was never reached by a jump
+	if (!this->visited.contains(end_node)) {
+		return path;
+	}
+
+	// Expand the jump points into every cell along the straight lines between them
+	std::vector<unsigned int> jump_points;
+	this->trace_path(start_node, end_node, jump_points);
+	auto timer = this->stats.time(search_phase::PATH_RECONSTRUCTION);
+	path.push_back(start_node);
+	for (unsigned int k = 1; k < jump_points.size(); k++) {
+		int x = (int)(jump_points[k - 1] % grid.width);
+		int y = (int)(jump_points[k - 1] / grid.width);
+		int tx = (int)(jump_points[k] % grid.width);
+		int ty = (int)(jump_points[k] / grid.width);
+		int dx = (tx > x) - (tx < x);
+		int dy = (ty > y) - (ty < y);
+		while (x != tx || y != ty) {
+			x += dx;
+			y += dy;
+			path.push_back((unsigned int)(y * width + x));
+		}
+	}
+	return path;
+};
+
+
+
+template <class Stats>
+template <class G, class R>
+std::vector<unsigned int> basic_search_engine<Stats>::bidirectional_BFS(const G& view, const R& reverse, unsigned int start_node, unsigned int end_node) {
+	std::vector<unsigned int> path;
+	if (start_node == end_node) {
+		path.push_back(start_node);
+		return path;
+	}
+	if (start_node >= view.node_count() || end_node >= view.node_count()) {
+		return path;
+	}
+
+	auto query = this->stats.query(*this);
+	unsigned int nodes = view.node_count();
+	this->reset_bidirectional(nodes);
+	if (this->cost.size() < nodes) {
+		this->cost.resize(nodes);
+	}
+	if (this->cost_back.size() < nodes) {
+		this->cost_back.resize(nodes);
+	}
+
+	// The backward tree stores, for each node, the next node towards the end
+	this->queue.assign(1, start_node);
+	this->queue_back.assign(1, end_node);
+	this->visited.insert(start_node);
+	this->visited_back.insert(end_node);
+	this->parent[start_node] = start_node;
+	this->parent_back[end_node] = end_node;
+	this->cost[start_node] = 0;
+	this->cost_back[end_node] = 0;
+
+	std::size_t head = 0;
+	std::size_t head_back = 0;
+	unsigned int best = NO_NODE;
+	unsigned int meet = NO_NODE;
+
+	while (head < this->queue.size() && head_back < this->queue_back.size() && meet == NO_NODE) {
+		if (this->queue.size() - head <= this->queue_back.size() - head_back) {
+			// Expand one level forward
+			std::size_t level_end = this->queue.size();
+			for (; head < level_end; head++) {
+				unsigned int curr_node = this->queue[head];
+				this->stats.expand();
+				for (unsigned int i = 0; i < view.degree(curr_node); i++) {
+					unsigned int next = view.neighbor(curr_node, i);
+					this->stats.scan();
+					if (next == NO_NODE || this->visited.contains(next)) {
+						continue;
+					}
+					this->visited.insert(next);
+					this->parent[next] = curr_node;
+					this->cost[next] = this->cost[curr_node] + 1;
+					if (this->visited_back.contains(next) && this->cost[next] + this->cost_back[next] < best) {
+						best = this->cost[next] + this->cost_back[next];
+						meet = next;
+					}
+					this->queue.push_back(next);
+				}
+			}
+		}
+		else {
+			// Expand one level backward, along incoming edges
+			std::size_t level_end = this->queue_back.size();
+			for (; head_back < level_end; head_back++) {
+				unsigned int curr_node = this->queue_back[head_back];
+				this->stats.expand();
+				for (unsigned int i = 0; i < reverse.degree(curr_node); i++) {
+					unsigned int prev = reverse.neighbor(curr_node, i);
+					this->stats.scan();
+					if (prev == NO_NODE || this->visited_back.contains(prev)) {
+						continue;
+					}
+					this->visited_back.insert(prev);
+					this->parent_back[prev] = curr_node;
+					this->cost_back[prev] = this->cost_back[curr_node] + 1;
+					if (this->visited.contains(prev) && this->cost[prev] + this->cost_back[prev] < best) {
+						best = this->cost[prev] + this->cost_back[prev];
+						meet = prev;
+					}
+					this->queue_back.push_back(prev);
+				}
+			}
+		}
+		this->stats.frontier((this->queue.size() - head) + (this->queue_back.size() - head_back));
+	}
+
+	if (meet != NO_NODE) {
+		this->join_paths(start_node, meet, path);
+	}
+	return path;
+};
+
+
+
+template <class Stats>
+template <class G, class R, class W>
+std::vector<unsigned int> basic_search_engine<Stats>::bidirectional_Dijkstra(const G& view, const R& reverse, unsigned int start_node, unsigned int end_node, W weight) {
+	std::vector<unsigned int> path;
+	if (start_node == end_node) {
+		path.push_back(start_node);
+		return path;
+	}
+	if (start_node >= view.node_count() || end_node >= view.node_count()) {
+		return path;
+	}
+
+	auto query = this->stats.query(*this);
+	unsigned int nodes = view.node_count();
+	this->reset_bidirectional(nodes);
+	this->closed.clear(nodes);
+	this->closed_back.clear(nodes);
+	if (this->distance.size() < nodes) {
+		this->distance.resize(nodes);
+	}
+	if (this->distance_back.size() < nodes) {
+		this->distance_back.resize(nodes);
+	}
+
+	this->heap.assign(1, { 0.0, start_node });
+	this->heap_back.assign(1, { 0.0, end_node });
+	this->visited.insert(start_node);
+	this->visited_back.insert(end_node);
+	this->parent[start_node] = start_node;
+	this->parent_back[end_node] = end_node;
+	this->distance[start_node] = 0;
+	this->distance_back[end_node] = 0;
+
+	double best = std::numeric_limits<double>::infinity();
+	unsigned int meet = NO_NODE;
+
+	while (!this->heap.empty() && !this->heap_back.empty()) {
+		// No path through an unsettled node can be shorter than the best one
+		if (this->heap.front().key + this->heap_back.front().key >= best) {
+			break;
+		}
+
+		if (this->heap.front().key <= this->heap_back.front().key) {
+			// Settle the closest node of the forward side
+			std::pop_heap(this->heap.begin(), this->heap.end());
+			distance_entry top = this->heap.back();
+			this->heap.pop_back();
+			if (this->closed.contains(top.node) || top.key != this->distance[top.node]) {
+				continue;
+			}
+			this->closed.insert(top.node);
+			this->stats.expand();
+
+			for (unsigned int i = 0; i < view.degree(top.node); i++) {
+				unsigned int next = view.neighbor(top.node, i);
+				this->stats.scan();
+				if (next == NO_NODE) {
+					continue;
+				}
+				double next_distance = top.key + weight(view, top.node, i);
+				if (!this->visited.contains(next) || next_distance < this->distance[next]) {
+					this->visited.insert(next);
+					this->distance[next] = next_distance;
+					this->parent[next] = top.node;
+					this->heap.push_back({ next_distance, next });
+					std::push_heap(this->heap.begin(), this->heap.end());
+					if (this->visited_back.contains(next) && next_distance + this->distance_back[next] < best) {
+						best = next_distance + this->distance_back[next];
+						meet = next;
+					}
+				}
+			}
+		}
+		else {
+			// Settle the closest node of the backward side
+			std::pop_heap(this->heap_back.begin(), this->heap_back.end());
+			distance_entry top = this->heap_back.back();
+			this->heap_back.pop_back();
+			if (this->closed_back.contains(top.node) || top.key != this->distance_back[top.node]) {
+				continue;
+			}
+			this->closed_back.insert(top.node);
+			this->stats.expand();
+
+			for (unsigned int i = 0; i < reverse.degree(top.node); i++) {
+				unsigned int prev = reverse.neighbor(top.node, i);
+				this->stats.scan();
+				if (prev == NO_NODE) {
+					continue;
+				}
+				double prev_distance = top.key + weight(view, prev, reverse.slot(top.node, i));
+				if (!this->visited_back.contains(prev) || prev_distance < this->distance_back[prev]) {
+					this->visited_back.insert(prev);
+					this->distance_back[prev] = prev_distance;
+					this->parent_back[prev] = top.node;
+					this->heap_back.push_back({ prev_distance, prev });
+					std::push_heap(this->heap_back.begin(), this->heap_back.end());
+					if (this->visited.contains(prev) && prev_distance + this->distance[prev] < best) {
+						best = prev_distance + this->distance[prev];
+						meet = prev;
+					}
+				}
+			}
+		}
+		this->stats.frontier(this->heap.size() + this->heap_back.size());
+	}
+
+	if (meet != NO_NODE) {
+		this->join_paths(start_node, meet, path);
+	}
+	return path;
+};
+
+
+
+template <class Stats>
+template <class G, class W>
+std::vector<unsigned int> basic_search_engine<Stats>::Dijkstra(const G& view, unsigned int start_node, unsigned int end_node, W weight) {
+	typedef decltype(weight(view, start_node, 0)) weight_type;
+	std::vector<unsigned int> path;
+	if (start_node >= view.node_count()) {
+		return path;
+	}
+
+	auto query = this->stats.query(*this);
+	unsigned int nodes = view.node_count();
+	this->reset(nodes);
+	this->closed.clear(nodes);
+	if (this->parent.size() < nodes) {
+		this->parent.resize(nodes);
+	}
+	if (this->distance.size() < nodes) {
+		this->distance.resize(nodes);
+	}
+	this->visited.insert(start_node);
+	this->parent[start_node] = start_node;
+	this->distance[start_node] = 0;
+
+	// Integer weights: the keys are exact integers, so the radix heap can
+	// be used (a node may be queued more than once, stale entries are skipped)
+	if constexpr (std::is_integral<weight_type>::value) {
+		this->rheap.reset();
+		this->rheap.push(0, start_node);
+		while (!this->rheap.empty()) {
+			unsigned long long key;
+			unsigned int curr_node = this->rheap.pop(key);
+			if (this->closed.contains(curr_node) || (double)key != this->distance[curr_node]) {
+				continue;
+			}
+			this->closed.insert(curr_node);
+			this->stats.expand();
+			if (curr_node == end_node) {
+				break;
+			}
+			for (unsigned int i = 0; i < view.degree(curr_node); i++) {
+				unsigned int next = view.neighbor(curr_node, i);
+				this->stats.scan();
+				if (next == NO_NODE || this->closed.contains(next)) {
+					continue;
+				}
+				unsigned long long next_key = key + (unsigned long long)weight(view, curr_node, i);
+				if (!this->visited.contains(next) || (double)next_key < this->distance[next]) {
+					this->visited.insert(next);
+					this->distance[next] = (double)next_key;
+					this->parent[next] = curr_node;
+					this->rheap.push(next_key, next);
+				}
+			}
+			this->stats.frontier(this->rheap.size());
+		}
+	}
+	else {
+		this->dheap.reset(nodes);
+		this->dheap.push(start_node, 0.0);
+		while (!this->dheap.empty()) {
+			unsigned int curr_node = this->dheap.pop();
+			this->closed.insert(curr_node);
+			this->stats.expand();
+			if (curr_node == end_node) {
+				break;
+			}
+			for (unsigned int i = 0; i < view.degree(curr_node); i++) {
+				unsigned int next = view.neighbor(curr_node, i);
+				this->stats.scan();
+				if (next == NO_NODE || this->closed.contains(next)) {
+					continue;
+				}
+				double next_distance = this->distance[curr_node] + (double)weight(view, curr_node, i);
+				if (!this->visited.contains(next) || next_distance < this->distance[next]) {
+					this->visited.insert(next);
+					this->distance[next] = next_distance;
+					this->parent[next] = curr_node;
+					this->dheap.push(next, next_distance);
+				}
+			}
+			this->stats.frontier(this->dheap.size());
+		}
+	}
+
+	if (end_node != NO_NODE && end_node < nodes && this->closed.contains(end_node)) {
+		this->trace_path(start_node, end_node, path);
+	}
+	return path;
+};
+
+
+
+  /////////////////////////////////////////////////////////////////////
+ //                         WORKER POOL CLASS                       //
+/////////////////////////////////////////////////////////////////////
+
+
+
+class worker_pool {
+	// This class keeps a fixed set of threads alive so that parallel
+	// algorithms can run many short steps without starting new threads
+	// for each one. run(task) calls task(index) once on every thread of
+	// the pool (the calling thread takes index 0) and returns when all of
+	// them have finished.
+public:
+	// Create a pool with 'threads' threads in total (0 = one per hardware thread)
+	worker_pool(unsigned int threads = 0);
+
+	~worker_pool();
+
+	worker_pool(const worker_pool&) = delete;
+	worker_pool& operator=(const worker_pool&) = delete;
+
+	unsigned int size() const { return (unsigned int)this->workers.size() + 1; }
+
+	void run(const std::function<void(unsigned int)>& task);
+
+private:
+	void work(unsigned int index);
+
+	std::vector<std::thread> workers;
+	std::mutex lock;
+	std::condition_variable wake;
+	std::condition_variable done;
+	const std::function<void(unsigned int)>* task;
+	unsigned long long generation;
+	unsigned int pending;
+	bool stopping;
+};
+
+
+
+worker_pool::worker_pool(unsigned int threads) {
+	if (threads == 0) {
+		threads = std::max(1u, std::thread::hardware_concurrency());
+	}
+	this->task = nullptr;
+	this->generation = 0;
+	this->pending = 0;
+	this->stopping = false;
+	for (unsigned int i = 1; i < threads; i++) {
+		this->workers.push_back(std::thread(&worker_pool::work, this, i));
+	}
+};
+
+
+
+worker_pool::~worker_pool() {
+	{
+		std::lock_guard<std::mutex> guard(this->lock);
+		this->stopping = true;
+	}
+	this->wake.notify_all();
+	for (unsigned int i = 0; i < this->workers.size(); i++) {
+		this->workers[i].join();
+	}
+};
+
+
+
+void worker_pool::run(const std::function<void(unsigned int)>& in_task) {
+	{
+		std::lock_guard<std::mutex> guard(this->lock);
+		this->task = &in_task;
+		this->pending = (unsigned int)this->workers.size();
+		this->generation++;
+	}
+	this->wake.notify_all();
+
+	// The calling thread does its share of the work too
+	in_task(0);
+
+	std::unique_lock<std::mutex> guard(this->lock);
+	this->done.wait(guard, [this]() { return this->pending == 0; });
+};
+
+
+
+void worker_pool::work(unsigned int index) {
+	unsigned long long seen = 0;
+	while (true) {
+		const std::function<void(unsigned int)>* current;
+		{
+			std::unique_lock<std::mutex> guard(this->lock);
+			this->wake.wait(guard, [&]() { return this->stopping || this->generation != seen; });
+			if (this->stopping) {
+				return;
+			}
+			seen = this->generation;
+			current = this->task;
+		}
+
+		(*current)(index);
+
+		std::lock_guard<std::mutex> guard(this->lock);
+		if (--this->pending == 0) {
+			this->done.notify_one();
+		}
+	}
+};
+
+
+
+  /////////////////////////////////////////////////////////////////////
+ //                      BATCHED QUERY CLASSES                      //
+/////////////////////////////////////////////////////////////////////
+
+
+
+// One point-to-point path query
+struct path_query {
+	unsigned int start_node;
+	unsigned int end_node;
+};
+
+
+
+class path_batch {
+	// This class holds the paths found for a batch of queries in two flat
+	// arrays: all paths are stored back to back in 'nodes', and the path
+	// of query i is nodes[offsets[i]] up to nodes[offsets[i + 1]]. An empty
+	// path means there was no path. A whole batch costs two allocations,
+	// however many queries it answers.
+public:
+	std::size_t size() const { return this->offsets.empty() ? 0 : this->offsets.size() - 1; }
+
+	std::size_t length(std::size_t i) const { return this->offsets[i + 1] - this->offsets[i]; }
+
+	const unsigned int* begin(std::size_t i) const { return this->nodes.data() + this->offsets[i]; }
+
+	const unsigned int* end(std::size_t i) const { return this->nodes.data() + this->offsets[i + 1]; }
+
+	// Copy of the path of query i
+	std::vector<unsigned int> path(std::size_t i) const { return std::vector<unsigned int>(this->begin(i), this->end(i)); }
+
+	std::vector<std::size_t> offsets;
+	std::vector<unsigned int> nodes;
+};
+
+
+
+class batch_runner {
+	// This class answers batches of independent path queries on a
+	// worker_pool. Every thread owns a search_engine, whose buffers (and
+	// epoch-stamped visited sets) are reused by each query that thread
+	// runs, so the threads share nothing but the read-only graph and a
+	// query does not clear or allocate O(V) memory. The threads claim
+	// small chunks of the batch from an atomic counter, so long and short
+	// queries balance out. Keep the runner alive between batches to keep
+	// its threads and buffers.
+public:
+	// Create a runner with 'threads' threads (0 = one per hardware thread)
+	batch_runner(unsigned int threads = 0) : pool(threads) {
+		this->scratch.resize(this->pool.size());
+	}
+
+	unsigned int size() const { return this->pool.size(); }
+
+	// Call 'search(engine, query)' for every query, and collect the paths
+	// it returns (as std::vector<unsigned int>) in query order. 'search'
+	// runs on several threads at once, so it must only read shared data.
+	template <class F>
+	path_batch run(const std::vector<path_query>& queries, F search);
+
+private:
+	// Buffers of one thread, on their own cache lines
+	struct alignas(64) worker_scratch {
+		search_engine engine;
+		std::vector<unsigned int> nodes;
+	};
+
+	// Where a thread stored the path of one query
+	struct result {
+		unsigned int worker;
+		std::size_t offset;
+		std::size_t length;
+	};
+
+	worker_pool pool;
+	std::vector<worker_scratch> scratch;
+	std::vector<result> results;
+};
+
+
+
+template <class F>
+path_batch batch_runner::run(const std::vector<path_query>& queries, F search) {
+	const std::size_t CHUNK = 16;
+	std::size_t count = queries.size();
+	this->results.resize(count);
+	std::atomic<std::size_t> next(0);
+
+	// Answer the queries, every thread appending its paths to its own buffer
+	this->pool.run([&](unsigned int index) {
+		worker_scratch& own = this->scratch[index];
+		own.nodes.clear();
+		for (std::size_t first = next.fetch_add(CHUNK); first < count; first = next.fetch_add(CHUNK)) {
+			std::size_t last = std::min(count, first + CHUNK);
+			for (std::size_t q = first; q < last; q++) {
+				std::vector<unsigned int> path = search(own.engine, queries[q]);
+				this->results[q] = { index, own.nodes.size(), path.size() };
+				own.nodes.insert(own.nodes.end(), path.begin(), path.end());
+			}
+		}
+	});
+
+	// Lay the paths out back to back, in query order
+	path_batch batch;
+	batch.offsets.resize(count + 1);
+	batch.offsets[0] = 0;
+	for (std::size_t q = 0; q < count; q++) {
+		batch.offsets[q + 1] = batch.offsets[q] + this->results[q].length;
+	}
+	batch.nodes.resize(batch.offsets[count]);
+
+	next = 0;
+	this->pool.run([&](unsigned int) {
+		for (std::size_t first = next.fetch_add(CHUNK); first < count; first = next.fetch_add(CHUNK)) {
+			std::size_t last = std::min(count, first + CHUNK);
+			for (std::size_t q = first; q < last; q++) {
+				const result& found = this->results[q];
+				const unsigned int* source = this->scratch[found.worker].nodes.data() + found.offset;
+				std::copy(source, source + found.length, batch.nodes.begin() + batch.offsets[q]);
+			}
+		}
+	});
+	return batch;
+};
+
+
+
+  /////////////////////////////////////////////////////////////////////
+ //                        REVERSE GRAPH CLASS                      //
+/////////////////////////////////////////////////////////////////////
+
+
+
+class reverse_graph {
+	// This class stores the incoming edges of every node of a graph view,
+	// in CSR form: the sources of the edges into node 'i' are stored at
+	// positions offsets[i] to offsets[i + 1], along with the index of each
+	// edge in its source's adjacency. It is itself a graph view
+	// (of the transposed graph), so it can be searched like any other.
+public:
+	// Build the incoming edges of a graph view
+	template <class G>
+	void build(const G& view);
+
+	unsigned int node_count() const { return this->offsets.empty() ? 0 : (unsigned int)(this->offsets.size() - 1); }
+
+	std::size_t edge_count() const { return this->sources.size(); }
+
+	unsigned int degree(unsigned int node) const { return (unsigned int)(this->offsets[node + 1] - this->offsets[node]); }
+
+	unsigned int neighbor(unsigned int node, unsigned int i) const { return this->sources[this->offsets[node] + i]; }
+
+	// Index of incoming edge 'i' within the adjacency of its source
+	unsigned int slot(unsigned int node, unsigned int i) const { return this->slots[this->offsets[node] + i]; }
+
+private:
+	std::vector<std::size_t> offsets;
+	std::vector<unsigned int> sources;
+	std::vector<unsigned int> slots;
+};
+
+
+
+template <class G>
+void reverse_graph::build(const G& view) {
+	unsigned int nodes = view.node_count();
+
+	// Count the incoming edges of every node
+	this->offsets.assign((std::size_t)nodes + 1, 0);
+	for (unsigned int i = 0; i < nodes; i++) {
+		for (unsigned int j = 0; j < view.degree(i); j++) {
+			unsigned int next = view.neighbor(i, j);
+			if (next != NO_NODE) {
+				this->offsets[next + 1]++;
+			}
+		}
+	}
+	for (unsigned int i = 0; i < nodes; i++) {
+		this->offsets[i + 1] += this->offsets[i];
+	}
+
+	// Place the sources, in increasing order for every node
+	this->sources.resize(this->offsets[nodes]);
+	this->slots.resize(this->offsets[nodes]);
+	std::vector<std::size_t> fill(this->offsets.begin(), this->offsets.end() - 1);
+	for (unsigned int i = 0; i < nodes; i++) {
+		for (unsigned int j = 0; j < view.degree(i); j++) {
+			unsigned int next = view.neighbor(i, j);
+			if (next != NO_NODE) {
+				this->slots[fill[next]] = j;
+				this->sources[fill[next]++] = i;
+			}
+		}
+	}
+};
+
+
+
+  /////////////////////////////////////////////////////////////////////
+ //                  PARALLEL DIRECTION-OPTIMIZING BFS              //
+/////////////////////////////////////////////////////////////////////
+
+
+
+// Result of a parallel BFS: the level (hop distance from the source) and
+// the BFS tree parent of every node. Both are NO_NODE for unreachable
+// nodes, and the source is its own parent.
+struct bfs_tree {
+	std::vector<unsigned int> level;
+	std::vector<unsigned int> parent;
+};
+
+
+
+// Breadth first search from 'source' over a graph view, on the threads of
+// 'pool'. Each level is expanded either top-down (the frontier scans its
+// outgoing edges) or bottom-up (every unvisited node scans its incoming
+// edges, in 'reverse', for a parent in the frontier), switching between
+// the two by frontier size as described by Beamer et al. Top-down steps
+// collect the next frontier in per-thread buffers and claim nodes in an
+// atomic visited bitmap. Small frontiers are expanded on the calling
+// thread alone, so long thin graphs like mazes do not pay for thread
+// synchronization on every level.
+template <class G>
+bfs_tree parallel_BFS(const G& view, const reverse_graph& reverse, unsigned int source, worker_pool& pool) {
+	// Switch to bottom-up when the frontier has more than 1/ALPHA of the
+	// unexplored edges, back to top-down when it has fewer than 1/BETA of the nodes
+	const unsigned long long ALPHA = 15;
+	const unsigned long long BETA = 18;
+	// Frontiers smaller than this are expanded top-down on one thread
+	const std::size_t SERIAL_FRONTIER = 1024;
+	// Number of frontier nodes a thread claims at a time
+	const std::size_t CHUNK = 256;
+
+	unsigned int nodes = view.node_count();
+	unsigned int threads = pool.size();
+	bfs_tree tree;
+	tree.level.assign(nodes, NO_NODE);
+	tree.parent.assign(nodes, NO_NODE);
+	if (source >= nodes) {
+		return tree;
+	}
+
+	std::size_t words = ((std::size_t)nodes + 63) / 64;
+	std::vector<std::atomic<unsigned long long>> visited(words);
+	for (std::size_t w = 0; w < words; w++) {
+		visited[w].store(0, std::memory_order_relaxed);
+	}
+	unsigned long long unexplored_edges = 0;
+	for (unsigned int i = 0; i < nodes; i++) {
+		unexplored_edges += view.degree(i);
+	}
+
+	std::vector<unsigned int> frontier(1, source);
+	std::vector<std::vector<unsigned int>> next_frontier(threads);
+	std::vector<unsigned long long> next_edges(threads);
+	std::vector<unsigned long long> next_count(threads);
+	std::vector<unsigned long long> frontier_bits;
+	std::vector<unsigned long long> next_bits;
+	std::atomic<std::size_t> cursor(0);
+	unsigned long long frontier_edges = view.degree(source);
+	unsigned int depth = 0;
+
+	tree.level[source] = 0;
+	tree.parent[source] = source;
+	visited[source / 64].fetch_or(1ULL << (source % 64));
+
+	// One top-down step on thread 'index': claim chunks of the frontier
+	// and every unvisited node they point to
+	auto top_down = [&](unsigned int index) {
+		std::vector<unsigned int>& local = next_frontier[index];
+		unsigned long long edges = 0;
+		while (true) {
+			std::size_t begin = cursor.fetch_add(CHUNK);
+			if (begin >= frontier.size()) {
+				break;
+			}
+			std::size_t end = std::min(begin + CHUNK, frontier.size());
+			for (std::size_t k = begin; k < end; k++) {
+				unsigned int curr_node = frontier[k];
+				for (unsigned int i = 0; i < view.degree(curr_node); i++) {
+					unsigned int next = view.neighbor(curr_node, i);
+					if (next == NO_NODE) {
+						continue;
+					}
+					unsigned long long bit = 1ULL << (next % 64);
+					if (visited[next / 64].load(std::memory_order_relaxed) & bit) {
+						continue;
+					}
+					if (visited[next / 64].fetch_or(bit) & bit) {
+						continue;
+					}
+					tree.level[next] = depth + 1;
+					tree.parent[next] = curr_node;
+					local.push_back(next);
+					edges += view.degree(next);
+				}
+			}
+		}
+		next_edges[index] = edges;
+	};
+
+	// One bottom-up step on thread 'index': every unvisited node of the
+	// thread's range looks for an incoming edge from the frontier. The
+	// ranges are whole bitmap words, so no word is shared between threads.
+	auto bottom_up = [&](unsigned int index) {
+		std::size_t first_word = words * index / threads;
+		std::size_t last_word = words * (index + 1) / threads;
+		unsigned long long edges = 0;
+		unsigned long long found = 0;
+		for (std::size_t w = first_word; w < last_word; w++) {
+			unsigned long long bits = 0;
+			unsigned long long seen = visited[w].load(std::memory_order_relaxed);
+			for (unsigned int b = 0; b < 64; b++) {
+				unsigned long long node = w * 64 + b;
+				if (node >= nodes || (seen >> b) & 1) {
+					continue;
+				}
+				for (unsigned int i = 0; i < reverse.degree((unsigned int)node); i++) {
+					unsigned int prev = reverse.neighbor((unsigned int)node, i);
+					if ((frontier_bits[prev / 64] >> (prev % 64)) & 1) {
+						tree.level[node] = depth + 1;
+						tree.parent[node] = prev;
+						bits |= 1ULL << b;
+						edges += view.degree((unsigned int)node);
+						found++;
+						break;
+					}
+				}
+			}
+			next_bits[w] = bits;
+			if (bits != 0) {
+				visited[w].fetch_or(bits, std::memory_order_relaxed);
+			}
+		}
+		next_edges[index] = edges;
+		next_count[index] = found;
+	};
+
+	while (!frontier.empty()) {
+		if (frontier_edges > unexplored_edges / ALPHA) {
+			// Bottom-up steps, for as long as the frontier stays large
+			frontier_bits.assign(words, 0);
+			next_bits.assign(words, 0);
+			for (std::size_t k = 0; k < frontier.size(); k++) {
+				frontier_bits[frontier[k] / 64] |= 1ULL << (frontier[k] % 64);
+			}
+			unsigned long long frontier_size = frontier.size();
+			unsigned long long previous_size = 0;
+			do {
+				pool.run(bottom_up);
+				previous_size = frontier_size;
+				frontier_size = 0;
+				frontier_edges = 0;
+				for (unsigned int t = 0; t < threads; t++) {
+					frontier_size += next_count[t];
+					frontier_edges += next_edges[t];
+				}
+				unexplored_edges -= std::min(unexplored_edges, frontier_edges);
+				frontier_bits.swap(next_bits);
+				depth++;
+			} while (frontier_size > 0 && (frontier_size >= previous_size || frontier_size > nodes / BETA));
+
+			// Back to a frontier list for the next top-down step
+			frontier.clear();
+			for (std::size_t w = 0; w < words; w++) {
+				for (unsigned int b = 0; frontier_bits[w] != 0 && b < 64; b++) {
+					if ((frontier_bits[w] >> b) & 1) {
+						frontier.push_back((unsigned int)(w * 64 + b));
+					}
+				}
+			}
+			continue;
+		}
+
+		// Top-down step
+		unexplored_edges -= std::min(unexplored_edges, frontier_edges);
+		cursor.store(0);
+		if (frontier.size() < SERIAL_FRONTIER || threads == 1) {
+			top_down(0);
+			for (unsigned int t = 1; t < threads; t++) {
+				next_edges[t] = 0;
+			}
+		}
+		else {
+			pool.run(top_down);
+		}
+
+		frontier.clear();
+		frontier_edges = 0;
+		for (unsigned int t = 0; t < threads; t++) {
+			frontier.insert(frontier.end(), next_frontier[t].begin(), next_frontier[t].end());
+			frontier_edges += next_edges[t];
+			next_frontier[t].clear();
+		}
+		depth++;
+	}
+	return tree;
+};
+
+
+
+  /////////////////////////////////////////////////////////////////////
+ //                       MULTI-SOURCE BFS                          //
+/////////////////////////////////////////////////////////////////////
+
+
+
+// Index of the lowest set bit of a non-zero word
+unsigned int lowest_bit(unsigned long long bits) {
+#if defined(__GNUC__) || defined(__clang__)
+	return (unsigned int)__builtin_ctzll(bits);
+#else
+	unsigned int b = 0;
+	while (!((bits >> b) & 1)) {
+		b++;
+	}
+	return b;
+#endif
+};
+
+
+
+// Distance summary of one source of a multi-source BFS: its eccentricity
+// (the distance to the farthest node it reaches), the number of nodes it
+// reaches (itself included) and the sum of the distances to them. A
+// source outside of the graph reaches nothing.
+struct bfs_summary {
+	unsigned int source;
+	unsigned int eccentricity;
+	unsigned int reached;
+	unsigned long long distance_sum;
+
+	// Closeness centrality over the nodes the source reaches: the inverse
+	// of their average distance (0 if it reaches no other node)
+	double closeness() const { return this->distance_sum == 0 ? 0.0 : (double)(this->reached - 1) / this->distance_sum; }
+};
+
+
+
+// Breadth first searches from many sources at once over a graph view
+// (MS-BFS, as described by Then et al.). The sources are packed 64 *
+// Words to a batch, one bit lane each, and every node holds Words
+// machine words of lanes: the searches that have seen it, and the ones
+// that reached it on the current level. Expanding a node then advances
+// every search of the batch that reached it on that level with one pass
+// over its edges and a few bitwise operations per edge (which the
+// compiler vectorizes for several words), instead of one pass per search.
+// The searches share the most work on graphs of small diameter, where
+// they reach most nodes on the same few levels; on long thin graphs such
+// as mazes, every node is reached on a different level by almost every
+// search, and nothing is shared. The batches run on the threads of
+// 'pool', each thread with its own 3 * Words words per node.
+// Returns the summary of every source, in the order of 'sources'.
+template <unsigned int Words = 1, class G>
+std::vector<bfs_summary> multi_source_BFS(const G& view, const std::vector<unsigned int>& sources, worker_pool& pool) {
+	const unsigned int LANES = 64 * Words;
+	unsigned int nodes = view.node_count();
+	std::size_t batches = (sources.size() + LANES - 1) / LANES;
+	std::vector<bfs_summary> summaries(sources.size());
+	std::atomic<std::size_t> next_batch(0);
+
+	pool.run([&](unsigned int) {
+		// Lanes of every node: seen, reached on this level, reached on the next one
+		std::vector<unsigned long long> seen;
+		std::vector<unsigned long long> visit;
+		std::vector<unsigned long long> next;
+		std::vector<unsigned int> frontier;
+		std::vector<unsigned int> upcoming;
+		std::vector<unsigned int> counts(LANES, 0);
+
+		for (std::size_t batch = next_batch++; batch < batches; batch = next_batch++) {
+			if (seen.empty()) {
+				seen.resize((std::size_t)nodes * Words, 0);
+				visit.resize((std::size_t)nodes * Words, 0);
+				next.resize((std::size_t)nodes * Words, 0);
+			}
+			else {
+				std::fill(seen.begin(), seen.end(), 0);
+			}
+
+			// Start every lane at its source
+			std::size_t first = batch * LANES;
+			unsigned int lanes = (unsigned int)std::min<std::size_t>(LANES, sources.size() - first);
+			frontier.clear();
+			for (unsigned int lane = 0; lane < lanes; lane++) {
+				unsigned int source = sources[first + lane];
+				summaries[first + lane] = { source, 0, 0, 0 };
+				if (source >= nodes) {
+					continue;
+				}
+				summaries[first + lane].reached = 1;
+				unsigned long long* lanes_at = &visit[(std::size_t)source * Words];
+				bool queued = false;
+				for (unsigned int w = 0; w < Words; w++) {
+					queued |= lanes_at[w] != 0;
+				}
+				if (!queued) {
+					frontier.push_back(source);
+				}
+				lanes_at[lane / 64] |= 1ULL << (lane % 64);
+				seen[(std::size_t)source * Words + lane / 64] |= 1ULL << (lane % 64);
+			}
+
+			for (unsigned int level = 1; !frontier.empty(); level++) {
+				// Pass the lanes of the frontier to the neighbors that have not seen them
+				upcoming.clear();
+				for (unsigned int node : frontier) {
+					const unsigned long long* lanes_here = &visit[(std::size_t)node * Words];
+					for (unsigned int i = 0; i < view.degree(node); i++) {
+						unsigned int neighbor = view.neighbor(node, i);
+						if (neighbor >= nodes) {
+							continue;
+						}
+						const unsigned long long* seen_there = &seen[(std::size_t)neighbor * Words];
+						unsigned long long* next_there = &next[(std::size_t)neighbor * Words];
+						unsigned long long fresh = 0;
+						unsigned long long queued = 0;
+						for (unsigned int w = 0; w < Words; w++) {
+							unsigned long long lanes_new = lanes_here[w] & ~seen_there[w];
+							queued |= next_there[w];
+							next_there[w] |= lanes_new;
+							fresh |= lanes_new;
+						}
+						if (fresh != 0 && queued == 0) {
+							upcoming.push_back(neighbor);
+						}
+					}
+				}
+
+				// The frontier is done; mark what the next one reached as seen,
+				// and count its nodes per lane
+				for (unsigned int node : frontier) {
+					for (unsigned int w = 0; w < Words; w++) {
+						visit[(std::size_t)node * Words + w] = 0;
+					}
+				}
+				unsigned long long active[Words] = {};
+				for (unsigned int node : upcoming) {
+					for (unsigned int w = 0; w < Words; w++) {
+						unsigned long long bits = next[(std::size_t)node * Words + w];
+						seen[(std::size_t)node * Words + w] |= bits;
+						active[w] |= bits;
+						while (bits != 0) {
+							counts[w * 64 + lowest_bit(bits)]++;
+							bits &= bits - 1;
+						}
+					}
+				}
+				for (unsigned int w = 0; w < Words; w++) {
+					for (unsigned long long bits = active[w]; bits != 0; bits &= bits - 1) {
+						unsigned int lane = w * 64 + lowest_bit(bits);
+						bfs_summary& summary = summaries[first + lane];
+						summary.eccentricity = level;
+						summary.reached += counts[lane];
+						summary.distance_sum += (unsigned long long)level * counts[lane];
+						counts[lane] = 0;
+					}
+				}
+				visit.swap(next);
+				frontier.swap(upcoming);
+			}
+		}
+	});
+	return summaries;
+};
+
+
+
+  /////////////////////////////////////////////////////////////////////
+ //                      COMPONENT INDEX CLASS                      //
+/////////////////////////////////////////////////////////////////////
+
+
+
+class component_index {
+	// This class rules out impossible path queries in O(1), so a search
+	// between two unconnected nodes can return "no path" at once instead
+	// of exploring everything reachable from the start. It keeps:
+	//  - the weakly connected components (edges taken as undirected), in
+	//    a union-find forest that is built in parallel and then grows by
+	//    one union for every added edge;
+	//  - for directed graphs, a rank per node from the strongly connected
+	//    components (found with Tarjan's algorithm), such that every edge
+	//    goes to a node of equal or lower rank. A path can then only lead
+	//    from a node to nodes ranked at most as high.
+	// Both only ever rule paths out: a query between different components,
+	// or from a node ranked below the end node, has no path.
+public:
+	component_index() { this->ranks_valid = false; }
+
+	// Build the index over a view, on the threads of 'pool'. If 'directed'
+	// is set, also rank the strongly connected components (serially).
+	template <class G>
+	void build(const G& view, bool directed, worker_pool& pool);
+
+	// Account for a new edge without rebuilding: unite the components of
+	// its ends, and keep the ranks only if the edge agrees with them
+	void add_edge(unsigned int source, unsigned int destination);
+
+	// Representative node of a node's component
+	unsigned int component(unsigned int node) const {
+		while (this->parent[node] != node) {
+			node = this->parent[node];
+		}
+		return node;
+	}
+
+	// False if there cannot be a path from 'start_node' to 'end_node'
+	bool may_reach(unsigned int start_node, unsigned int end_node) const {
+		if (start_node == end_node) {
+			return true;
+		}
+		if (start_node >= this->parent.size() || end_node >= this->parent.size()) {
+			return false;
+		}
+		if (this->component(start_node) != this->component(end_node)) {
+			return false;
+		}
+		return !this->ranks_valid || this->rank[start_node] >= this->rank[end_node];
+	}
+
+	unsigned int node_count() const { return (unsigned int)this->parent.size(); }
+
+	bool has_ranks() const { return this->ranks_valid; }
+
+private:
+	// Root of a node's tree in the concurrent forest, halving the path on the way
+	static unsigned int find(std::atomic<unsigned int>* links, unsigned int node);
+
+	// Rank the strongly connected components with an iterative Tarjan's algorithm
+	template <class G>
+	void rank_components(const G& view);
+
+	std::vector<unsigned int> parent;
+	std::vector<unsigned int> rank;
+	bool ranks_valid;
+};
+
+
+
+unsigned int component_index::find(std::atomic<unsigned int>* links, unsigned int node) {
+	while (true) {
+		unsigned int up = links[node].load(std::memory_order_relaxed);
+		if (up == node) {
+			return node;
+		}
+		unsigned int grand = links[up].load(std::memory_order_relaxed);
+		if (grand != up) {
+			links[node].compare_exchange_weak(up, grand);
+		}
+		node = grand;
+	}
+};
+
+
+
+template <class G>
+void component_index::build(const G& view, bool directed, worker_pool& pool) {
+	// Number of nodes a thread claims at a time
+	const unsigned int CHUNK = 4096;
+
+	unsigned int nodes = view.node_count();
+	std::unique_ptr<std::atomic<unsigned int>[]> links(new std::atomic<unsigned int>[nodes]);
+	std::atomic<unsigned int> cursor(0);
+
+	// Every node starts as its own tree. Trees are only ever linked from
+	// the larger root to the smaller one, so concurrent unions cannot form
+	// a cycle; a failed link means another thread moved the root first.
+	auto unite = [&](unsigned int) {
+		for (unsigned int first = cursor.fetch_add(CHUNK); first < nodes; first = cursor.fetch_add(CHUNK)) {
+			unsigned int last = std::min(nodes, first + CHUNK);
+			for (unsigned int node = first; node < last; node++) {
+				for (unsigned int i = 0; i < view.degree(node); i++) {
+					unsigned int next = view.neighbor(node, i);
+					if (next == NO_NODE) {
+						continue;
+					}
+					unsigned int a = node;
+					unsigned int b = next;
+					while (true) {
+						a = find(links.get(), a);
+						b = find(links.get(), b);
+						if (a == b) {
+							break;
+						}
+						if (a < b) {
+							std::swap(a, b);
+						}
+						unsigned int expected = a;
+						if (links[a].compare_exchange_strong(expected, b)) {
+							break;
+						}
+					}
+				}
+			}
+		}
+	};
+
+	for (unsigned int node = 0; node < nodes; node++) {
+		links[node].store(node, std::memory_order_relaxed);
+	}
+	pool.run(unite);
+
+	// Flatten the forest, so every node points straight at its root
+	this->parent.resize(nodes);
+	cursor.store(0);
+	pool.run([&](unsigned int) {
+		for (unsigned int first = cursor.fetch_add(CHUNK); first < nodes; first = cursor.fetch_add(CHUNK)) {
+			unsigned int last = std::min(nodes, first + CHUNK);
+			for (unsigned int node = first; node < last; node++) {
+				this->parent[node] = find(links.get(), node);
+			}
+		}
+	});
+
+	this->ranks_valid = false;
+	this->rank.clear();
+	if (directed) {
+		this->rank_components(view);
+		this->ranks_valid = true;
+	}
+};
+
+
+
+template <class G>
+void component_index::rank_components(const G& view) {
+	// Call stack entry: a node, and the index of the next edge to try from it
+	struct frame {
+		unsigned int node;
+		unsigned int next;
+	};
+
+	// The components are completed in reverse topological order (the ones
+	// with no edges out first), so numbering them in that order gives every
+	// edge a target of equal or lower rank. A node is on Tarjan's stack
+	// while it has an index but no rank yet.
+	unsigned int nodes = view.node_count();
+	std::vector<unsigned int> index(nodes, NO_NODE);
+	std::vector<unsigned int> low(nodes);
+	std::vector<unsigned int> members;
+	std::vector<frame> calls;
+	unsigned int counter = 0;
+	unsigned int components = 0;
+	this->rank.assign(nodes, NO_NODE);
+
+	for (unsigned int root = 0; root < nodes; root++) {
+		if (index[root] != NO_NODE) {
+			continue;
+		}
+		index[root] = low[root] = counter++;
+		members.push_back(root);
+		calls.push_back({ root, 0 });
+
+		while (!calls.empty()) {
+			unsigned int node = calls.back().node;
+			if (calls.back().next < view.degree(node)) {
+				unsigned int next = view.neighbor(node, calls.back().next++);
+				if (next == NO_NODE) {
+					continue;
+				}
+				if (index[next] == NO_NODE) {
+					index[next] = low[next] = counter++;
+					members.push_back(next);
+					calls.push_back({ next, 0 });
+				}
+				else if (this->rank[next] == NO_NODE) {
+					low[node] = std::min(low[node], index[next]);
+				}
+				continue;
+			}
+
+			// All edges tried: close the component if this node is its root
+			calls.pop_back();
+			if (low[node] == index[node]) {
+				unsigned int member;
+				do {
+					member = members.back();
+					members.pop_back();
+					this->rank[member] = components;
+				} while (member != node);
+				components++;
+			}
+			if (!calls.empty()) {
+				unsigned int caller = calls.back().node;
+				low[caller] = std::min(low[caller], low[node]);
+			}
+		}
+	}
+};
+
+
+
+void component_index::add_edge(unsigned int source, unsigned int destination) {
+	// New nodes start alone, with the lowest rank (they have no edges yet)
+	unsigned int nodes = std::max(source, destination) + 1;
+	for (unsigned int node = (unsigned int)this->parent.size(); node < nodes; node++) {
+		this->parent.push_back(node);
+	}
+	if (this->ranks_valid && this->rank.size() < nodes) {
+		this->rank.resize(nodes, 0);
+	}
+
+	// Unite the two trees (halving the paths to their roots on the way)
+	unsigned int roots[2] = { source, destination };
+	for (unsigned int k = 0; k < 2; k++) {
+		unsigned int& node = roots[k];
+		while (this->parent[node] != node) {
+			this->parent[node] = this->parent[this->parent[node]];
+			node = this->parent[node];
+		}
+	}
+	if (roots[0] != roots[1]) {
+		this->parent[std::max(roots[0], roots[1])] = std::min(roots[0], roots[1]);
+	}
+
+	// An edge to a higher rank breaks the order; until the next build only
+	// the components are used
+	if (this->ranks_valid && this->rank[source] < this->rank[destination]) {
+		this->ranks_valid = false;
+	}
+};
+
+
+
+  /////////////////////////////////////////////////////////////////////
+ //                    INCREMENTAL PLANNER CLASS                    //
+/////////////////////////////////////////////////////////////////////
+
+
+
+class dstar_lite {
+	// This class keeps a shortest path from a start node to a goal node up
+	// to date while the graph changes, with D* Lite (Koenig and Likhachev).
+	// It searches backward from the goal, and keeps for every node it has
+	// reached its distance to the goal (g) and a one-step lookahead of it
+	// (rhs, one more than the smallest g among its neighbors). When nodes
+	// are blocked or opened, only the nodes whose distance changes are
+	// searched again, so a few changes near the path cost far less than a
+	// new search. The start may also move (an agent walking the path)
+	// without starting over.
+	// The view must be undirected with unit edge costs, like grid_graph:
+	// the neighbors of a node are also the nodes it is entered from. The
+	// queue is ordered with the Manhattan distance when the node ids are
+	// width * row + column (a width of 0 turns the heuristic off).
+public:
+	dstar_lite() : heuristic(0, 0) { this->start = NO_NODE; this->goal = NO_NODE; this->width = 0; this->km = 0; this->expanded = 0; }
+
+	// Plan from 'start_node' to 'goal_node' from scratch, and return the path (empty if there is none)
+	template <class G>
+	graph_path plan(const G& view, unsigned int start_node, unsigned int goal_node, unsigned int grid_width = 0);
+
+	// The edges of 'node' changed. After opening or blocking a node, call
+	// this for the node and for each of its neighbors, then call repair().
+	template <class G>
+	void update(const G& view, unsigned int node);
+
+	// Move the start, e.g. to the next node of the path once it is walked
+	void move_start(unsigned int start_node);
+
+	// Bring the path up to date after updates and moves, and return it
+	template <class G>
+	graph_path repair(const G& view);
+
+	// Distance from a node to the goal, as far as the planner knows (NO_NODE if unknown or unreachable)
+	unsigned int distance(unsigned int node) const { return node < this->g.size() ? this->g[node] : NO_NODE; }
+
+	bool planned() const { return this->goal != NO_NODE; }
+
+	unsigned int start_node() const { return this->start; }
+
+	unsigned int goal_node() const { return this->goal; }
+
+	// Nodes expanded by the last plan() or repair()
+	unsigned long long expanded;
+
+private:
+	// Queue keys: the estimated length of a path through the node, then its distance to the goal
+	typedef std::pair<unsigned long long, unsigned int> key_type;
+
+	key_type key(unsigned int node) const {
+		unsigned int best = std::min(this->g[node], this->rhs[node]);
+		return key_type((unsigned long long)best + this->heuristic(node) + this->km, best);
+	}
+
+	// One more than the smallest distance among the neighbors of 'node'
+	template <class G>
+	unsigned int lookahead(const G& view, unsigned int node) const;
+
+	// Queue the node if its distance and lookahead disagree, remove it otherwise
+	void enqueue(unsigned int node);
+
+	// Settle nodes until the distance of the start is known
+	template <class G>
+	void compute(const G& view);
+
+	// Walk from the start to the goal through the nodes closest to the goal
+	template <class G>
+	graph_path walk(const G& view) const;
+
+	std::vector<unsigned int> g;
+	std::vector<unsigned int> rhs;
+	dary_heap<key_type> queue;
+	unsigned int start;
+	unsigned int goal;
+	unsigned int width;
+	// Distance from the current start, and the total it has moved (so older keys stay lower bounds)
+	manhattan_distance heuristic;
+	unsigned long long km;
+};
+
+
+
+template <class G>
+graph_path dstar_lite::plan(const G& view, unsigned int start_node, unsigned int goal_node, unsigned int grid_width) {
+	unsigned int nodes = view.node_count();
+	this->start = start_node;
+	this->goal = goal_node;
+	this->width = grid_width;
+	this->heuristic = manhattan_distance(grid_width, start_node);
+	this->km = 0;
+	this->g.assign(nodes, NO_NODE);
+	this->rhs.assign(nodes, NO_NODE);
+	this->queue.reset(nodes);
+	if (start_node >= nodes || goal_node >= nodes) {
+		this->goal = NO_NODE;
+		return graph_path();
+	}
+
+	this->rhs[goal_node] = 0;
+	this->enqueue(goal_node);
+	return this->repair(view);
+};
+
+
+
+template <class G>
+void dstar_lite::update(const G& view, unsigned int node) {
+	if (node < this->g.size() && node != this->goal) {
+		this->rhs[node] = this->lookahead(view, node);
+		this->enqueue(node);
+	}
+};
+
+
+
+void dstar_lite::move_start(unsigned int start_node) {
+	this->km += this->heuristic(start_node);
+	this->heuristic = manhattan_distance(this->width, start_node);
+	this->start = start_node;
+};
+
+
+
+template <class G>
+graph_path dstar_lite::repair(const G& view) {
+	if (!this->planned() || this->start >= this->g.size()) {
+		return graph_path();
+	}
+	this->compute(view);
+	return this->walk(view);
+};
+
+
+
+template <class G>
+unsigned int dstar_lite::lookahead(const G& view, unsigned int node) const {
+	unsigned int best = NO_NODE;
+	for (unsigned int i = 0; i < view.degree(node); i++) {
+		unsigned int next = view.neighbor(node, i);
+		if (next != NO_NODE && this->g[next] != NO_NODE) {
+			best = std::min(best, this->g[next] + 1);
+		}
+	}
+	return best;
+};
+
+
+
+void dstar_lite::enqueue(unsigned int node) {
+	if (this->g[node] != this->rhs[node]) {
+		if (this->queue.contains(node)) {
+			this->queue.update(node, this->key(node));
+		}
+		else {
+			this->queue.push(node, this->key(node));
+		}
+	}
+	else if (this->queue.contains(node)) {
+		this->queue.erase(node);
+	}
+};
+
+
+
+template <class G>
+void dstar_lite::compute(const G& view) {
+	this->expanded = 0;
+	while (!this->queue.empty() && (this->queue.top_key() < this->key(this->start) || this->rhs[this->start] != this->g[this->start])) {
+		unsigned int node = this->queue.top();
+		key_type old_key = this->queue.top_key();
+		key_type new_key = this->key(node);
+
+		// The start moved since the node was queued: requeue it with its current key
+		if (old_key < new_key) {
+			this->queue.update(node, new_key);
+			continue;
+		}
+		this->queue.pop();
+		this->expanded++;
+
+		if (this->g[node] > this->rhs[node]) {
+			// The node got closer to the goal: settle it, and offer it to its neighbors
+			this->g[node] = this->rhs[node];
+			for (unsigned int i = 0; i < view.degree(node); i++) {
+				unsigned int next = view.neighbor(node, i);
+				if (next != NO_NODE && next != this->goal && this->g[node] + 1 < this->rhs[next]) {
+					this->rhs[next] = this->g[node] + 1;
+					this->enqueue(next);
+				}
+			}
+		}
+		else {
+			// The node got further from the goal: forget its distance, and
+			// recompute the neighbors whose lookahead went through it
+			unsigned int old_distance = this->g[node];
+			this->g[node] = NO_NODE;
+			this->update(view, node);
+			for (unsigned int i = 0; i < view.degree(node); i++) {
+				unsigned int next = view.neighbor(node, i);
+				if (next != NO_NODE && next != this->goal && this->rhs[next] == old_distance + 1) {
+					this->rhs[next] = this->lookahead(view, next);
+					this->enqueue(next);
+				}
+			}
+		}
+	}
+};
+
+
+
+template <class G>
+graph_path dstar_lite::walk(const G& view) const {
+	std::vector<unsigned int> path;
+	if (this->g[this->start] == NO_NODE) {
+		return graph_path();
+	}
+
+	// Each step goes to a neighbor one closer to the goal
+	unsigned int node = this->start;
+	path.push_back(node);
+	while (node != this->goal) {
+		unsigned int best = NO_NODE;
+		for (unsigned int i = 0; i < view.degree(node); i++) {
+			unsigned int next = view.neighbor(node, i);
+			if (next != NO_NODE && this->g[next] != NO_NODE && (best == NO_NODE || this->g[next] < this->g[best])) {
+				best = next;
+			}
+		}
+		if (best == NO_NODE || this->g[best] >= this->g[node]) {
+			return graph_path();
+		}
+		node = best;
+		path.push_back(node);
+	}
+	return graph_path(std::move(path), this->width);
+};
+
+
+
+  /////////////////////////////////////////////////////////////////////
+ //                        VERTEX ORDER CLASS                       //
+/////////////////////////////////////////////////////////////////////
+
+
+
+class vertex_order {
+	// This class renumbers the nodes of a graph so that nodes that are
+	// searched together are stored together (see Graph<T>::freeze). Node
+	// ids usually follow the input: in a maze, a step up or down jumps a
+	// whole row of the CSR arrays, and the ids of a general graph are in
+	// whatever order its edges arrived. A search over a graph of millions
+	// of nodes then waits on memory at almost every edge.
+	//  - morton() and hilbert() number the cells of a width x height grid
+	//    (node width * row + column) along a Z-order or a Hilbert curve,
+	//    so the cells of every small square are numbered close together.
+	//    The Hilbert curve never jumps, so it keeps more neighbors close.
+	//  - reverse_cuthill_mckee() and breadth_first() number the nodes of
+	//    any graph in breadth first order, so the neighbors of a node
+	//    are numbered close to each other. Reverse Cuthill-McKee starts
+	//    each component from a node of lowest degree, visits neighbors by
+	//    increasing degree, and then reverses the order.
+	// It keeps the map both ways, so the searches can take and return the
+	// original ids. An empty order leaves every id as it is.
+public:
+	vertex_order() {}
+
+	// Number the nodes in the order of 'sequence': new node 'n' is old
+	// node sequence[n]. Returns false (and leaves the order empty) if
+	// 'sequence' is not a permutation of 0 .. size - 1.
+	bool assign(std::vector<unsigned int> sequence);
+
+	// Breadth first orders of the nodes of a view (following the edges
+	// as they go; nodes no edge leads to start new trees)
+	template <class G>
+	void reverse_cuthill_mckee(const G& view);
+
+	template <class G>
+	void breadth_first(const G& view);
+
+	// Space-filling curve orders of the cells of a grid
+	void morton(unsigned int width, unsigned int height);
+
+	void hilbert(unsigned int width, unsigned int height);
+
+	void clear() { this->to_new.clear(); this->to_old.clear(); }
+
+	bool empty() const { return this->to_old.empty(); }
+
+	unsigned int size() const { return (unsigned int)this->to_old.size(); }
+
+	// New id of an original node, and original id of a new node. Ids
+	// outside of the order (such as NO_NODE) are returned as they are.
+	unsigned int new_id(unsigned int node) const { return node < this->to_new.size() ? this->to_new[node] : node; }
+
+	unsigned int old_id(unsigned int node) const { return node < this->to_old.size() ? this->to_old[node] : node; }
+
+	// Turn a path of new ids back into original ids
+	void original_ids(std::vector<unsigned int>& path) const {
+		for (unsigned int& node : path) {
+			node = this->old_id(node);
+		}
+	}
+
+	// Original node of every new id
+	const std::vector<unsigned int>& sequence() const { return this->to_old; }
+
+private:
+	// Number the nodes breadth first, visiting the roots and each node's
+	// new neighbors by increasing degree if 'by_degree' is set
+	template <class G>
+	void visit(const G& view, bool by_degree);
+
+	// Number the cells of a grid by increasing 'key(x, y)'
+	template <class K>
+	void by_key(unsigned int width, unsigned int height, K key);
+
+	std::vector<unsigned int> to_new;
+	std::vector<unsigned int> to_old;
+};
+
+
+
+bool vertex_order::assign(std::vector<unsigned int> sequence) {
+	this->clear();
+	std::vector<unsigned int> inverse(sequence.size(), NO_NODE);
+	for (unsigned int n = 0; n < sequence.size(); n++) {
+		if (sequence[n] >= sequence.size() || inverse[sequence[n]] != NO_NODE) {
+			return false;
+		}
+		inverse[sequence[n]] = n;
+	}
+	this->to_old = std::move(sequence);
+	this->to_new = std::move(inverse);
+	return true;
+};
+
+
+
+template <class G>
+void vertex_order::reverse_cuthill_mckee(const G& view) {
+	this->visit(view, true);
+	std::reverse(this->to_old.begin(), this->to_old.end());
+	for (unsigned int n = 0; n < this->to_old.size(); n++) {
+		this->to_new[this->to_old[n]] = n;
+	}
+};
+
+
+
+template <class G>
+void vertex_order::breadth_first(const G& view) {
+	this->visit(view, false);
+};
+
+
+
+template <class G>
+void vertex_order::visit(const G& view, bool by_degree) {
+	unsigned int nodes = view.node_count();
+	this->to_new.assign(nodes, NO_NODE);
+	this->to_old.clear();
+	this->to_old.reserve(nodes);
+
+	// Roots, by increasing degree (stable, so ties keep their order)
+	std::vector<unsigned int> roots(nodes);
+	for (unsigned int i = 0; i < nodes; i++) {
+		roots[i] = i;
+	}
+	auto lighter = [&](unsigned int a, unsigned int b) { return view.degree(a) < view.degree(b); };
+	if (by_degree) {
+		std::stable_sort(roots.begin(), roots.end(), lighter);
+	}
+
+	// The order itself is the queue: the nodes are numbered as they are queued
+	for (unsigned int root : roots) {
+		if (this->to_new[root] != NO_NODE) {
+			continue;
+		}
+		this->to_new[root] = (unsigned int)this->to_old.size();
+		this->to_old.push_back(root);
+		for (std::size_t head = this->to_old.size() - 1; head < this->to_old.size(); head++) {
+			unsigned int node = this->to_old[head];
+			std::size_t first = this->to_old.size();
+			for (unsigned int i = 0; i < view.degree(node); i++) {
+				unsigned int next = view.neighbor(node, i);
+				if (next < nodes && this->to_new[next] == NO_NODE) {
+					this->to_new[next] = (unsigned int)this->to_old.size();
+					this->to_old.push_back(next);
+				}
+			}
+			if (by_degree) {
+				std::stable_sort(this->to_old.begin() + first, this->to_old.end(), lighter);
+				for (std::size_t n = first; n < this->to_old.size(); n++) {
+					this->to_new[this->to_old[n]] = (unsigned int)n;
+				}
+			}
+		}
+	}
+};
+
+
+
+void vertex_order::morton(unsigned int width, unsigned int height) {
+	// Interleave the bits of the column and the row
+	auto spread = [](unsigned long long v) {
+		v = (v | (v << 16)) & 0x0000FFFF0000FFFFull;
+		v = (v | (v << 8)) & 0x00FF00FF00FF00FFull;
+		v = (v | (v << 4)) & 0x0F0F0F0F0F0F0F0Full;
+		v = (v | (v << 2)) & 0x3333333333333333ull;
+		v = (v | (v << 1)) & 0x5555555555555555ull;
+		return v;
+	};
+	this->by_key(width, height, [&](unsigned int x, unsigned int y) { return spread(x) | (spread(y) << 1); });
+};
+
+
+
+void vertex_order::hilbert(unsigned int width, unsigned int height) {
+	// Distance along the Hilbert curve filling the smallest power of two
+	// square that covers the grid, rotating the quadrant at every level
+	unsigned long long side = 1;
+	while (side < width || side < height) {
+		side <<= 1;
+	}
+	this->by_key(width, height, [side](unsigned int col, unsigned int row) {
+		unsigned long long x = col;
+		unsigned long long y = row;
+		unsigned long long d = 0;
+		for (unsigned long long s = side / 2; s > 0; s /= 2) {
+			unsigned long long rx = (x & s) != 0;
+			unsigned long long ry = (y & s) != 0;
+			d += s * s * ((3 * rx) ^ ry);
+			if (ry == 0) {
+				if (rx == 1) {
+					x = side - 1 - x;
+					y = side - 1 - y;
+				}
+				std::swap(x, y);
+			}
+		}
+		return d;
+	});
+};
+
+
+
+template <class K>
+void vertex_order::by_key(unsigned int width, unsigned int height, K key) {
+	this->clear();
+	if ((unsigned long long)width * height > NO_NODE) {
+		std::cerr << "The grid is too large to renumber" << std::endl;
+		return;
+	}
+	unsigned int cells = width * height;
+	std::vector<std::pair<unsigned long long, unsigned int>> keys(cells);
+	for (unsigned int y = 0; y < height; y++) {
+		for (unsigned int x = 0; x < width; x++) {
+			keys[y * width + x] = std::make_pair(key(x, y), y * width + x);
+		}
+	}
+	std::sort(keys.begin(), keys.end());
+
+	this->to_old.resize(cells);
+	this->to_new.resize(cells);
+	for (unsigned int n = 0; n < cells; n++) {
+		this->to_old[n] = keys[n].second;
+		this->to_new[keys[n].second] = n;
+	}
+};
+
+
+
+  /////////////////////////////////////////////////////////////////////
+ //                      GENERAL GRAPH CLASS                        //
+/////////////////////////////////////////////////////////////////////
+
+
+
+template <class T>
+class Graph {
+	/* THIS IS AN ABSTRACT BASE CLASS AND SHOULD NOT BE INSTANTIATED
+	 This class represents a general graph. This graph is implemented
+	 in an adjacency list format. This general base class is templated
+	 so that it may store metadata (commonly edge weight) of any
+	 data type, including user-defined types. The metadata type is
+	 a parameter of the class (shown as 'T' in my code). Because this
+	 base class is generalized, there are no requirements for what the
+	 metadata must be; however, if the user provides a user-defined
+	 struct or class as the template parameter, then the included
+	 print_graph() function will not work correctly. The user would
+	 need to create their own print function within the derived class.*/
+public:
+	// Default constructor and parameterized constructor. The adjacency
+	// list is allocated from 'resource' (the default heap unless set
+	// otherwise), which must outlive the graph. With an arena, such as a
+	// std::pmr::monotonic_buffer_resource, the edges of the whole graph
+	// share a few large blocks, and freeing them is a no-op: the arena
+	// gives all its blocks back at once when it is released. Copies of
+	// the graph allocate from the default resource again.
+	Graph(std::pmr::memory_resource* resource = std::pmr::get_default_resource()) : adj_list(resource) { this->N = 0; this->frozen = false; this->reverse_valid = false; this->components_valid = false; this->stats = nullptr; };
+
+	Graph(std::vector<Edge<T>> in_vec, unsigned int size) {
+		this->adj_list.resize(size);
+		this->N = size;
+		this->frozen = false;
+		this->reverse_valid = false;
+		this->components_valid = false;
+		this->stats = nullptr;
+		this->add_edges(std::move(in_vec));
+	};
+
+
+	// Add an edge to the graph (with two additional overloads)
+	void add_edge(Edge<T> new_edge);
+
+	void add_edge(unsigned int source, unsigned int destination, T metadata);
+
+	void add_edge(unsigned int source, unsigned int destination);
+
+
+	// Add a batch of edges. The range is read twice (it must be a forward
+	// range): once to count the new edges of every node and find the
+	// largest node id, and once to place the edges, so the adjacency list
+	// and every node's edge vector are sized exactly once. Pass move
+	// iterators (or use the vector overload) to move the metadata in,
+	// which also allows move-only metadata types.
+	template <class ForwardIt>
+	void add_edges(ForwardIt first, ForwardIt last);
+
+	void add_edges(std::vector<Edge<T>>&& in_vec) {
+		this->add_edges(std::make_move_iterator(in_vec.begin()), std::make_move_iterator(in_vec.end()));
+	}
+
+	// Merge the edges many threads collected in a graph_builder, on
+	// 'threads' threads (0 = one per hardware thread), and empty the
+	// builder. Each thread owns a range of source nodes: the shards are
+	// first split by range (each shard by one thread), then every thread
+	// sizes the edge vectors of its own nodes once and moves their edges in,
+	// so no two threads ever touch the same node. Memory resources other
+	// than the heap are not thread-safe in general (an arena is not), so
+	// with one the edges are merged on one thread.
+	void add_edges(graph_builder<T>& builder, unsigned int threads = 0);
+
+
+	// Remove every edge from 'source' to 'destination', and return how
+	// many were removed. The other edges keep their order.
+	unsigned int remove_edge(unsigned int source, unsigned int destination);
+
+	// Remove every edge into and out of 'node', and return how many were
+	// removed. Nodes are numbered by their position in the adjacency list,
+	// so the node itself stays, without edges. The incoming edges are
+	// found with in_edges() if it is built, and by a scan of every edge
+	// otherwise.
+	// Removing edges can only split components, so the component index
+	// stays valid: it may let through some queries that have no path
+	// anymore, but never rules out one that has a path.
+	unsigned int remove_node(unsigned int node);
+
+
+	// Scan an input file to load the graph (virtual function)
+	virtual void load_graph() = 0;
+
+
+	// Run the implemented graph search algorithm (virtual function)
+	virtual graph_path run_algorithm(unsigned int start_node, unsigned int end_node) = 0;
+
+
+	// Iterative depth first and breadth first searches (see search_engine).
+	// Both return an empty path if there is no path.
+	graph_path DFS(unsigned int start_node, unsigned int end_node);
+
+	graph_path BFS(unsigned int start_node, unsigned int end_node);
+
+
+	// Bidirectional BFS and Dijkstra between two nodes, searching backward
+	// from the end node over in_edges(). The Dijkstra edge weights come
+	// from 'weight(view, node, i)' (read with edge_weight<T> by default).
+	graph_path bidirectional_BFS(unsigned int start_node, unsigned int end_node);
+
+	template <class W = meta_weight<edge_weight<T>>>
+	graph_path bidirectional_Dijkstra(unsigned int start_node, unsigned int end_node, W weight = W());
+
+
+	// Shortest path by edge weight (see search_engine::Dijkstra). By default
+	// the weights are read from the metadata with the edge_weight<T> trait.
+	template <class W = meta_weight<edge_weight<T>>>
+	graph_path Dijkstra(unsigned int start_node, unsigned int end_node, W weight = W());
+
+
+	// Multithreaded direction-optimizing BFS from 'source' over the whole
+	// graph (see parallel_BFS), on 'threads' threads (0 = one per hardware
+	// thread). Returns the level and parent of every node.
+	bfs_tree parallel_BFS(unsigned int source, unsigned int threads = 0);
+
+
+	// Distances from many sources at once (see multi_source_BFS), on
+	// 'threads' threads (0 = one per hardware thread), following the edges
+	// as they go: the eccentricity, reach and closeness centrality of every
+	// source, in the order of 'sources' (every node if 'sources' is empty).
+	// With every node as a source, the largest eccentricity is the
+	// diameter; with a sample of the nodes, it is a lower bound on it.
+	std::vector<bfs_summary> source_distances(std::vector<unsigned int> sources = std::vector<unsigned int>(), unsigned int threads = 0);
+
+
+	// Incoming edges of every node, built on first use and kept until the
+	// graph changes (or is frozen in another order)
+	const reverse_graph& in_edges();
+
+
+	// Component index of the graph (see component_index), built on first
+	// use on 'threads' threads (0 = one per hardware thread), and then
+	// updated by every add_edge() instead of being rebuilt
+	const component_index& reachability(unsigned int threads = 0);
+
+	// False if there cannot be a path from 'start_node' to 'end_node'
+	bool may_reach(unsigned int start_node, unsigned int end_node) {
+		return this->reachability().may_reach(this->order.new_id(start_node), this->order.new_id(end_node));
+	}
+
+
+	// Answer a batch of path queries on the threads of 'runner', each
+	// with 'algorithm' (A_STAR and JPS need a grid, so they run as BFS).
+	// Queries the component index rules out return no path at once.
+	// The graph is only read while the queries run; do not modify it
+	// until the call returns.
+	path_batch run_queries(batch_runner& runner, const std::vector<path_query>& queries, search_algorithm algorithm = search_algorithm::BFS);
+
+
+	// Print the graph (works on both the adjacency list and a frozen snapshot,
+	// in the original node ids):
+	void print_graph() {
+		this->visit_view([this](const auto& view) {
+			for (unsigned int i = 0; i < view.node_count(); i++) {
+				unsigned int node = this->order.new_id(i);
+				for (unsigned int j = 0; j < view.degree(node); j++) {
+					std::cout << "Source: " << i << " Destination: " << this->order.old_id(view.neighbor(node, j)) << " Metadata: " << view.meta(node, j) << std::endl;
+				}
+			}
+		});
+	}
+
+
+	// Freeze the graph into an immutable CSR snapshot. The adjacency list
+	// is released, and every read (print_graph, run_algorithm) goes through
+	// the snapshot until the graph is modified again.
+	// With a non-empty 'in_order' (see vertex_order), the snapshot stores
+	// the nodes in that order, even if the graph was already frozen. The
+	// searches, print_graph and the snapshot files still take and return
+	// the original ids; only the views (visit_view), in_edges() and
+	// reachability() are indexed by the new ids, see ordering(). An order
+	// that does not cover every node is ignored.
+	const csr_graph<T>& freeze(const vertex_order& in_order = vertex_order());
+
+	// Turn a frozen graph back into an adjacency list (called automatically
+	// by add_edge), in the original ids
+	void thaw();
+
+	bool is_frozen() const { return this->frozen; }
+
+	// Order of the nodes in the frozen snapshot (empty if they are in their original order)
+	const vertex_order& ordering() const { return this->order; }
+
+	// Memory resource the adjacency list is allocated from
+	std::pmr::memory_resource* memory_resource() const { return this->adj_list.get_allocator().resource(); }
+
+
+	// Write the graph to a versioned binary snapshot file (see
+	// snapshot_header): the CSR offsets and destinations, and the metadata
+	// if snapshot_metadata<T> allows it (for trivially copyable types by
+	// default). Returns false if it cannot be written.
+	bool save_snapshot(const std::string& path) const;
+
+	// Replace the graph with a snapshot file. The file is memory-mapped and
+	// becomes the frozen CSR snapshot of the graph as it is, so nothing is
+	// parsed or copied. Without stored metadata, every edge gets T(). The
+	// file must not change while it is mapped. Returns false (and leaves
+	// the graph unchanged) if the file is missing or not a snapshot of a
+	// Graph<T> built on this platform.
+	bool load_snapshot(const std::string& path);
+
+	// Count and time the searches and the loading (see search_stats) into
+	// '*in_stats', or stop when given nullptr. While no stats are set the
+	// searches run on an engine without any instrumentation.
+	void instrument(search_stats* in_stats) { this->stats = in_stats; }
+
+
+	// Call 'f' with a read-only view of whichever layout is active: a
+	// list_view<T> over the adjacency list, or the frozen csr_graph<T>.
+	// Both views expose node_count(), degree(), neighbor() and meta().
+	template <class F>
+	auto visit_view(F&& f) const -> decltype(f(std::declval<const csr_graph<T>&>()));
+
+
+protected:
+	// This 'adjacency list' is actually a vector of vectors, instead of
+	// the traditional array of lists. However, the funtionality is still
+	// the same, with the added benefit of it being simple and easily resizeable.
+	adjacency_list<T> adj_list;
+
+
+	// Number of nodes
+	unsigned int N;
+
+
+	// Frozen snapshot of the adjacency list, only valid while 'frozen' is
+	// set, and the order of its nodes
+	csr_graph<T> csr;
+	bool frozen;
+	vertex_order order;
+
+
+	// Reusable stack, queue and visited/parent arrays for DFS() and BFS()
+	search_engine engine;
+
+
+	// Statistics set by instrument(), and the instrumented engine used while they are set
+	search_stats* stats;
+	basic_search_engine<search_stats> traced_engine;
+
+
+	// Call 'search(engine)' with the plain engine, or with the instrumented
+	// one (adding its counters to 'stats') while statistics are recorded
+	template <class F>
+	std::vector<unsigned int> with_engine(F&& search);
+
+
+	// Free the adjacency list, keeping its memory resource
+	void release_edges() { adjacency_list<T>(this->adj_list.get_allocator()).swap(this->adj_list); }
+
+
+	// Write the offsets, destinations and metadata of the graph to a snapshot
+	void write_snapshot(snapshot_writer& out) const;
+
+	// Make the graph arrays of a checked snapshot file the frozen CSR
+	// snapshot, giving every edge 'fill' if the file stores no metadata
+	void map_snapshot(const std::shared_ptr<mapped_file>& file, const snapshot_header& header, const T& fill);
+
+
+	// Incoming edges, only valid while 'reverse_valid' is set
+	reverse_graph reverse;
+	bool reverse_valid;
+
+
+	// Components of the graph, only built once 'components_valid' is set
+	component_index components;
+	bool components_valid;
+};
+
+
+
+template <class T>
+template <class F>
+std::vector<unsigned int> Graph<T>::with_engine(F&& search) {
+	if (this->stats == nullptr) {
+		return search(this->engine);
+	}
+	this->traced_engine.stats = *this->stats;
+	std::vector<unsigned int> path = search(this->traced_engine);
+	*this->stats = this->traced_engine.stats;
+	return path;
+};
+
+
+
+template <class T>
+graph_path Graph<T>::bidirectional_BFS(unsigned int start_node, unsigned int end_node) {
+	const reverse_graph& reverse = this->in_edges();
+	std::vector<unsigned int> path = this->with_engine([&](auto& engine) {
+		return this->visit_view([&](const auto& view) {
+			return engine.bidirectional_BFS(view, reverse, this->order.new_id(start_node), this->order.new_id(end_node));
+		});
+	});
+	this->order.original_ids(path);
+	return graph_path(std::move(path));
+};
+
+
+
+template <class T>
+template <class W>
+graph_path Graph<T>::bidirectional_Dijkstra(unsigned int start_node, unsigned int end_node, W weight) {
+	const reverse_graph& reverse = this->in_edges();
+	std::vector<unsigned int> path = this->with_engine([&](auto& engine) {
+		return this->visit_view([&](const auto& view) {
+			return engine.bidirectional_Dijkstra(view, reverse, this->order.new_id(start_node), this->order.new_id(end_node), weight);
+		});
+	});
+	this->order.original_ids(path);
+	return graph_path(std::move(path));
+};
+
+
+
+template <class T>
+path_batch Graph<T>::run_queries(batch_runner& runner, const std::vector<path_query>& queries, search_algorithm algorithm) {
+	// Build the incoming edges before the threads start, so the queries
+	// themselves only read the graph
+	const reverse_graph* reverse = nullptr;
+	if (algorithm == search_algorithm::BIDIRECTIONAL_BFS || algorithm == search_algorithm::BIDIRECTIONAL_DIJKSTRA) {
+		reverse = &this->in_edges();
+	}
+	const component_index& index = this->reachability();
+
+	return this->visit_view([&](const auto& view) {
+		return runner.run(queries, [&](search_engine& engine, const path_query& query) {
+			unsigned int start_node = this->order.new_id(query.start_node);
+			unsigned int end_node = this->order.new_id(query.end_node);
+			std::vector<unsigned int> path;
+			if (!index.may_reach(start_node, end_node)) {
+				return path;
+			}
+			if (algorithm == search_algorithm::DFS) {
+				path = engine.DFS(view, start_node, end_node);
+			}
+			else if (algorithm == search_algorithm::BIDIRECTIONAL_BFS) {
+				path = engine.bidirectional_BFS(view, *reverse, start_node, end_node);
+			}
+			else if (algorithm == search_algorithm::BIDIRECTIONAL_DIJKSTRA) {
+				path = engine.bidirectional_Dijkstra(view, *reverse, start_node, end_node, meta_weight<edge_weight<T>>());
+			}
+			else if (algorithm == search_algorithm::DIJKSTRA) {
+				path = engine.Dijkstra(view, start_node, end_node, meta_weight<edge_weight<T>>());
+			}
+			else {
+				path = engine.BFS(view, start_node, end_node);
+			}
+			this->order.original_ids(path);
+			return path;
+		});
+	});
+};
+
+
+
+template <class T>
+template <class W>
+graph_path Graph<T>::Dijkstra(unsigned int start_node, unsigned int end_node, W weight) {
+	std::vector<unsigned int> path = this->with_engine([&](auto& engine) {
+		return this->visit_view([&](const auto& view) {
+			return engine.Dijkstra(view, this->order.new_id(start_node), this->order.new_id(end_node), weight);
+		});
+	});
+	this->order.original_ids(path);
+	return graph_path(std::move(path));
+};
+
+
+
+template <class T>
+bfs_tree Graph<T>::parallel_BFS(unsigned int source, unsigned int threads) {
+	const reverse_graph& reverse = this->in_edges();
+	worker_pool pool(threads);
+	bfs_tree tree = this->visit_view([&](const auto& view) {
+		return ::parallel_BFS(view, reverse, this->order.new_id(source), pool);
+	});
+	if (this->order.empty()) {
+		return tree;
+	}
+
+	// Index the levels and parents by the original ids again
+	bfs_tree original;
+	original.level.resize(tree.level.size());
+	original.parent.resize(tree.parent.size());
+	for (unsigned int i = 0; i < tree.level.size(); i++) {
+		original.level[i] = tree.level[this->order.new_id(i)];
+		original.parent[i] = this->order.old_id(tree.parent[this->order.new_id(i)]);
+	}
+	return original;
+};
+
+
+
+template <class T>
+std::vector<bfs_summary> Graph<T>::source_distances(std::vector<unsigned int> sources, unsigned int threads) {
+	if (sources.empty()) {
+		sources.resize(this->N);
+		for (unsigned int i = 0; i < this->N; i++) {
+			sources[i] = i;
+		}
+	}
+	for (unsigned int& source : sources) {
+		source = this->order.new_id(source);
+	}
+
+	// One word of lanes per node: wider lanes only pay off on graphs of
+	// small diameter, and cost twice as much per word on the others
+	worker_pool pool(threads);
+	std::vector<bfs_summary> summaries = this->visit_view([&](const auto& view) {
+		return multi_source_BFS(view, sources, pool);
+	});
+	for (bfs_summary& summary : summaries) {
+		summary.source = this->order.old_id(summary.source);
+	}
+	return summaries;
+};
+
+
+
+template <class T>
+const component_index& Graph<T>::reachability(unsigned int threads) {
+	if (!this->components_valid) {
+		worker_pool pool(threads);
+		this->visit_view([&](const auto& view) {
+			this->components.build(view, true, pool);
+		});
+		this->components_valid = true;
+	}
+	return this->components;
+};
+
+
+
+template <class T>
+const reverse_graph& Graph<T>::in_edges() {
+	if (!this->reverse_valid) {
+		this->visit_view([&](const auto& view) {
+			this->reverse.build(view);
+		});
+		this->reverse_valid = true;
+	}
+	return this->reverse;
+};
+
+
+
+template <class T>
+graph_path Graph<T>::DFS(unsigned int start_node, unsigned int end_node) {
+	std::vector<unsigned int> path = this->with_engine([&](auto& engine) {
+		return this->visit_view([&](const auto& view) {
+			return engine.DFS(view, this->order.new_id(start_node), this->order.new_id(end_node));
+		});
+	});
+	this->order.original_ids(path);
+	return graph_path(std::move(path));
+};
+
+
+
+template <class T>
+graph_path Graph<T>::BFS(unsigned int start_node, unsigned int end_node) {
+	std::vector<unsigned int> path = this->with_engine([&](auto& engine) {
+		return this->visit_view([&](const auto& view) {
+			return engine.BFS(view, this->order.new_id(start_node), this->order.new_id(end_node));
+		});
+	});
+	this->order.original_ids(path);
+	return graph_path(std::move(path));
+};
+
+
+
+template <class T>
+const csr_graph<T>& Graph<T>::freeze(const vertex_order& in_order) {
+	if (this->frozen && in_order.empty()) {
+		return this->csr;
+	}
+	this->thaw();
+	if (!in_order.empty() && in_order.size() != this->adj_list.size()) {
+		std::cerr << "The vertex order has " << in_order.size() << " nodes, the graph has " << this->adj_list.size() << std::endl;
+	}
+	else if (!in_order.empty()) {
+		this->order = in_order;
+		this->reverse_valid = false;
+		this->components_valid = false;
+	}
+
+	// Count the edges so every array is allocated exactly once
+	std::size_t edge_count = 0;
+	for (unsigned int i = 0; i < this->adj_list.size(); i++) {
+		edge_count += this->adj_list[i].size();
+	}
+
+	this->csr.offsets.resize(this->adj_list.size() + 1);
+	this->csr.destinations.resize(edge_count);
+	this->csr.meta_data.resize(edge_count);
+
+	// Copy the destinations into one contiguous array, and move the metadata
+	// into its own parallel array so traversals never touch it. Node 'n'
+	// of the snapshot is node order.old_id(n) of the adjacency list.
+	std::size_t pos = 0;
+	for (unsigned int n = 0; n < this->adj_list.size(); n++) {
+		unsigned int i = this->order.old_id(n);
+		this->csr.offsets[n] = pos;
+		for (unsigned int j = 0; j < this->adj_list[i].size(); j++) {
+			this->csr.destinations[pos] = this->order.new_id(this->adj_list[i][j].destination);
+			this->csr.meta_data[pos] = std::move(this->adj_list[i][j].meta());
+			pos++;
+		}
+	}
+	this->csr.offsets[this->adj_list.size()] = pos;
+	this->csr.bind();
+
+	// Release the adjacency list
+	this->release_edges();
+	this->frozen = true;
+	return this->csr;
+};
+
+
+
+template <class T>
+void Graph<T>::thaw() {
+	if (!this->frozen) {
+		return;
+	}
+
+	// The metadata can only be moved out of the snapshot's own array; a
+	// mapped file, or a value shared by every edge, is copied
+	unsigned int nodes = this->csr.node_count();
+	bool owned = !this->csr.is_mapped() && this->csr.meta_data.size() == this->csr.edge_count();
+	this->adj_list.resize(nodes);
+	for (unsigned int n = 0; n < nodes; n++) {
+		unsigned int i = this->order.old_id(n);
+		this->adj_list[i].resize(this->csr.degree(n));
+		for (unsigned int j = 0; j < this->csr.degree(n); j++) {
+			std::size_t pos = this->csr.offset_data[n] + j;
+			this->adj_list[i][j].destination = this->order.old_id(this->csr.destination_data[pos]);
+			// (Move-only metadata is never mapped or shared, so it is always moved)
+			if constexpr (std::is_copy_assignable<T>::value) {
+				if (!owned) {
+					this->adj_list[i][j].meta() = this->csr.meta(n, j);
+					continue;
+				}
+			}
+			this->adj_list[i][j].meta() = std::move(this->csr.meta_data[pos]);
+		}
+	}
+
+	this->csr = csr_graph<T>();
+	this->frozen = false;
+
+	// The indexes were built on the new ids
+	if (!this->order.empty()) {
+		this->order.clear();
+		this->reverse_valid = false;
+		this->components_valid = false;
+	}
+};
+
+
+
+template <class T>
+template <class F>
+auto Graph<T>::visit_view(F&& f) const -> decltype(f(std::declval<const csr_graph<T>&>())) {
+	if (this->frozen) {
+		return f(this->csr);
+	}
+	return f(list_view<T>(this->adj_list));
+};
+
+
+
+template <class T>
+void Graph<T>::add_edge(Edge<T> new_edge) {
+	// Due to the adjacency list representation, each 'node' is considered
+	// to be an integer between 0 and the length of the adjacency list. The
+	// nodes must be continuous, because we cannot leave a gap in our adjacency
+	// list, at least as it is currently implemented with vectors.
+
+	// A frozen graph is immutable, so turn it back into an adjacency list first
+	this->thaw();
+
+	// If either node is not included in the adjacency list, resize
+	unsigned int largest = std::max((unsigned int)new_edge.source, (unsigned int)new_edge.destination);
+	if (largest >= this->N) {
+		this->N = largest + 1;
+		this->adj_list.resize(this->N);
+	}
+
+	// Keep the component index up to date, if it was built
+	if (this->components_valid) {
+		this->components.add_edge(new_edge.source, new_edge.destination);
+	}
+
+	// Add the new edge
+	this->adj_list[new_edge.source].push_back(adjacency_entry<T>(new_edge.destination, std::move(new_edge.meta_data)));
+	this->reverse_valid = false;
+};
+
+
+
+template <class T>
+void Graph<T>::add_edge(unsigned int source, unsigned int destination, T metadata) {
+	Edge<T> temp = Edge<T>();
+	temp.source = source;
+	temp.destination = destination;
+	temp.meta_data = std::move(metadata);
+	this->add_edge(std::move(temp));
+};
+
+
+
+template <class T>
+void Graph<T>::add_edge(unsigned int source, unsigned int destination) {
+	Edge<T> temp = Edge<T>();
+	temp.source = source;
+	temp.destination = destination;
+	this->add_edge(std::move(temp));
+};
+
+
+
+template <class T>
+template <class ForwardIt>
+void Graph<T>::add_edges(ForwardIt first, ForwardIt last) {
+	this->thaw();
+
+	// First pass: count the new edges of every node and find the largest node id
+	std::vector<unsigned int> counts(this->N, 0);
+	unsigned int nodes = this->N;
+	for (ForwardIt it = first; it != last; ++it) {
+		unsigned int source = (unsigned int)(*it).source;
+		unsigned int destination = (unsigned int)(*it).destination;
+		nodes = std::max(nodes, std::max(source, destination) + 1);
+		if (source >= counts.size()) {
+			counts.resize(std::max((std::size_t)source + 1, counts.size() * 2));
+		}
+		counts[source]++;
+	}
+
+	// Size the adjacency list and every edge vector once
+	if (nodes > this->N) {
+		this->N = nodes;
+		this->adj_list.resize(this->N);
+	}
+	for (unsigned int i = 0; i < counts.size(); i++) {
+		if (counts[i] != 0) {
+			this->adj_list[i].reserve(this->adj_list[i].size() + counts[i]);
+		}
+	}
+
+	// Second pass: place the edges (moved, when given move iterators)
+	for (ForwardIt it = first; it != last; ++it) {
+		auto&& edge = *it;
+		unsigned int source = (unsigned int)edge.source;
+		this->adj_list[source].push_back(adjacency_entry<T>(edge.destination, std::forward<decltype(edge)>(edge).meta_data));
+		if (this->components_valid) {
+			this->components.add_edge(source, this->adj_list[source].back().destination);
+		}
+	}
+	this->reverse_valid = false;
+};
+
+
+
+template <class T>
+void Graph<T>::add_edges(graph_builder<T>& builder, unsigned int threads) {
+	this->thaw();
+	if (this->memory_resource() != std::pmr::new_delete_resource()) {
+		threads = 1;
+	}
+	worker_pool pool(threads);
+	unsigned int ranges = pool.size();
+	unsigned int shards = builder.producer_count();
+
+	// On one thread there is nothing to split: add the shards in turn
+	if (ranges == 1) {
+		for (unsigned int s = 0; s < shards; s++) {
+			this->add_edges(std::move(builder.edges(s)));
+		}
+		builder.clear();
+		return;
+	}
+
+	// Find the largest node id, one shard per thread at a time
+	std::vector<unsigned int> shard_nodes(shards, 0);
+	pool.run([&](unsigned int index) {
+		for (unsigned int s = index; s < shards; s += ranges) {
+			unsigned int largest = 0;
+			for (const Edge<T>& edge : builder.edges(s)) {
+				largest = std::max(largest, std::max((unsigned int)edge.source, (unsigned int)edge.destination) + 1);
+			}
+			shard_nodes[s] = largest;
+		}
+	});
+	unsigned int nodes = this->N;
+	for (unsigned int s = 0; s < shards; s++) {
+		nodes = std::max(nodes, shard_nodes[s]);
+	}
+	if (nodes == 0) {
+		return;
+	}
+	if (nodes > this->N) {
+		this->N = nodes;
+		this->adj_list.resize(this->N);
+	}
+
+	// Thread 'r' owns the source nodes from first_node(r) to first_node(r + 1)
+	auto range_of = [&](unsigned int node) { return (unsigned int)((unsigned long long)node * ranges / nodes); };
+	auto first_node = [&](unsigned int r) { return (unsigned int)(((unsigned long long)r * nodes + ranges - 1) / ranges); };
+
+	// Split every shard by range: the positions of its edges, grouped by
+	// the range of their source and otherwise in order
+	std::vector<std::vector<std::size_t>> split(shards);
+	std::vector<std::vector<std::size_t>> split_at(shards, std::vector<std::size_t>(ranges + 1, 0));
+	pool.run([&](unsigned int index) {
+		for (unsigned int s = index; s < shards; s += ranges) {
+			const std::vector<Edge<T>>& edges = builder.edges(s);
+			std::vector<std::size_t>& at = split_at[s];
+			for (const Edge<T>& edge : edges) {
+				at[range_of(edge.source) + 1]++;
+			}
+			for (unsigned int r = 0; r < ranges; r++) {
+				at[r + 1] += at[r];
+			}
+			std::vector<std::size_t> next(at.begin(), at.end() - 1);
+			split[s].resize(edges.size());
+			for (std::size_t k = 0; k < edges.size(); k++) {
+				split[s][next[range_of(edges[k].source)]++] = k;
+			}
+		}
+	});
+
+	// Every thread adds the edges of its own nodes: counts them, sizes each
+	// edge vector once, then moves the edges in, shard by shard
+	pool.run([&](unsigned int index) {
+		unsigned int first = first_node(index);
+		std::vector<unsigned int> counts(first_node(index + 1) - first, 0);
+		for (unsigned int s = 0; s < shards; s++) {
+			const std::vector<Edge<T>>& edges = builder.edges(s);
+			for (std::size_t k = split_at[s][index]; k < split_at[s][index + 1]; k++) {
+				counts[edges[split[s][k]].source - first]++;
+			}
+		}
+		for (unsigned int i = 0; i < counts.size(); i++) {
+			if (counts[i] != 0) {
+				this->adj_list[first + i].reserve(this->adj_list[first + i].size() + counts[i]);
+			}
+		}
+		for (unsigned int s = 0; s < shards; s++) {
+			std::vector<Edge<T>>& edges = builder.edges(s);
+			for (std::size_t k = split_at[s][index]; k < split_at[s][index + 1]; k++) {
+				Edge<T>& edge = edges[split[s][k]];
+				this->adj_list[edge.source].push_back(adjacency_entry<T>(edge.destination, std::move(edge.meta_data)));
+			}
+		}
+	});
+
+	// Keep the component index up to date, if it was built
+	if (this->components_valid) {
+		for (unsigned int s = 0; s < shards; s++) {
+			for (const Edge<T>& edge : builder.edges(s)) {
+				this->components.add_edge(edge.source, edge.destination);
+			}
+		}
+	}
+	this->reverse_valid = false;
+	builder.clear();
+};
+
+
+
+template <class T>
+unsigned int Graph<T>::remove_edge(unsigned int source, unsigned int destination) {
+	this->thaw();
+	if (source >= this->N) {
+		return 0;
+	}
+
+	std::pmr::vector<adjacency_entry<T>>& edges = this->adj_list[source];
+	std::size_t before = edges.size();
+	edges.erase(std::remove_if(edges.begin(), edges.end(), [&](const adjacency_entry<T>& edge) { return (unsigned int)edge.destination == destination; }), edges.end());
+	if (edges.size() != before) {
+		this->reverse_valid = false;
+	}
+	return (unsigned int)(before - edges.size());
+};
+
+
+
+template <class T>
+unsigned int Graph<T>::remove_node(unsigned int node) {
+	this->thaw();
+	if (node >= this->N) {
+		return 0;
+	}
+
+	std::size_t removed = this->adj_list[node].size();
+	this->adj_list[node].clear();
+	this->adj_list[node].shrink_to_fit();
+
+	// Remove the edges into 'node' from the lists of their sources
+	auto drop_edges = [&](unsigned int source) {
+		std::pmr::vector<adjacency_entry<T>>& edges = this->adj_list[source];
+		std::size_t before = edges.size();
+		edges.erase(std::remove_if(edges.begin(), edges.end(), [&](const adjacency_entry<T>& edge) { return (unsigned int)edge.destination == node; }), edges.end());
+		removed += before - edges.size();
+	};
+	if (this->reverse_valid) {
+		for (unsigned int i = 0; i < this->reverse.degree(node); i++) {
+			drop_edges(this->reverse.neighbor(node, i));
+		}
+	}
+	else {
+		for (unsigned int i = 0; i < this->N; i++) {
+			drop_edges(i);
+		}
+	}
+	this->reverse_valid = false;
+	return (unsigned int)removed;
+};
+
+
+
+  /////////////////////////////////////////////////////////////////////
+ //                            EDGE CLASS                           //
+/////////////////////////////////////////////////////////////////////
+
+
+
+template <class T>
+class Edge {
+	// This class represents the edges of the graph.
+	// As mentioned in the above class declaration, it
+	// has a template parameter that tells it what type
+	// of data to store.
+public:
+	int source, destination;
+	T meta_data;
+};
+
+
+
+template <class T, bool Empty>
+class adjacency_entry {
+	// This class is one edge in the adjacency list of its source node. The
+	// source is the position of the list, so only the destination (as a
+	// 4-byte node id) and the metadata are stored. Empty metadata types
+	// (such as no_metadata) use the specialization below, which stores the
+	// destination alone.
+public:
+	adjacency_entry() : destination(0), meta_data() {}
+
+	adjacency_entry(unsigned int in_destination, T in_meta) : destination(in_destination), meta_data(std::move(in_meta)) {}
+
+	const T& meta() const { return this->meta_data; }
+
+	T& meta() { return this->meta_data; }
+
+	unsigned int destination;
+	T meta_data;
+};
+
+
+
+template <class T>
+class adjacency_entry<T, true> {
+	// Edge of a graph whose metadata type is empty: every value of an empty
+	// type is the same, so one shared value stands for the metadata of all
+	// edges, and an edge takes 4 bytes.
+public:
+	adjacency_entry() : destination(0) {}
+
+	adjacency_entry(unsigned int in_destination, T) : destination(in_destination) {}
+
+	const T& meta() const { return shared(); }
+
+	T& meta() { return shared(); }
+
+	unsigned int destination;
+
+private:
+	static T& shared() {
+		static T value = T();
+		return value;
+	}
+};
+
+
+
+  /////////////////////////////////////////////////////////////////////
+ //                      CONCURRENT BUILDER CLASS                   //
+/////////////////////////////////////////////////////////////////////
+
+
+
+template <class T>
+class graph_builder {
+	// This class collects the edges of a Graph<T> from many threads at
+	// once, such as the threads of a parallel parser. Every producer
+	// appends to its own shard, a buffer no other thread touches (on its
+	// own cache lines), so adding an edge takes no lock and no atomic
+	// operation, and the producers never wait on each other.
+	// Graph<T>::add_edges(builder) then merges the shards into the
+	// adjacency list in parallel. The edges of a node end up in the order
+	// of the shards, and within a shard in the order they were added, so
+	// the graph is the same as if every shard had been added in turn.
+public:
+	// A builder with one shard per producer (0 = one per hardware thread)
+	graph_builder(unsigned int producers = 0) {
+		if (producers == 0) {
+			producers = std::max(1u, std::thread::hardware_concurrency());
+		}
+		this->shards.resize(producers);
+	}
+
+	// Add an edge to shard 'producer'. Any number of threads can add edges
+	// at once, as long as no two of them use the same shard at the same
+	// time (a thread can use the index worker_pool::run gives it).
+	void add_edge(unsigned int producer, Edge<T> new_edge) { this->shards[producer].edges.push_back(std::move(new_edge)); }
+
+	void add_edge(unsigned int producer, unsigned int source, unsigned int destination, T metadata);
+
+	void add_edge(unsigned int producer, unsigned int source, unsigned int destination);
+
+	// Make room for 'count' more edges in shard 'producer'
+	void reserve(unsigned int producer, std::size_t count) {
+		this->shards[producer].edges.reserve(this->shards[producer].edges.size() + count);
+	}
+
+	unsigned int producer_count() const { return (unsigned int)this->shards.size(); }
+
+	// Number of edges in every shard (only while no edges are being added)
+	std::size_t edge_count() const;
+
+	// The edges of a shard, in the order they were added
+	std::vector<Edge<T>>& edges(unsigned int producer) { return this->shards[producer].edges; }
+
+	// Drop every edge, keeping the shards
+	void clear();
+
+private:
+	struct alignas(64) shard {
+		std::vector<Edge<T>> edges;
+	};
+
+	std::vector<shard> shards;
+};
+
+
+
+template <class T>
+void graph_builder<T>::add_edge(unsigned int producer, unsigned int source, unsigned int destination, T metadata) {
+	Edge<T> temp = Edge<T>();
+	temp.source = source;
+	temp.destination = destination;
+	temp.meta_data = std::move(metadata);
+	this->add_edge(producer, std::move(temp));
+};
+
+
+
+template <class T>
+void graph_builder<T>::add_edge(unsigned int producer, unsigned int source, unsigned int destination) {
+	Edge<T> temp = Edge<T>();
+	temp.source = source;
+	temp.destination = destination;
+	this->add_edge(producer, std::move(temp));
+};
+
+
+
+template <class T>
+std::size_t graph_builder<T>::edge_count() const {
+	std::size_t count = 0;
+	for (const shard& s : this->shards) {
+		count += s.edges.size();
+	}
+	return count;
+};
+
+
+
+template <class T>
+void graph_builder<T>::clear() {
+	for (shard& s : this->shards) {
+		std::vector<Edge<T>>().swap(s.edges);
+	}
+};
+
+
+
+  /////////////////////////////////////////////////////////////////////
+ //                     CSR SNAPSHOT / VIEW CLASSES                 //
+/////////////////////////////////////////////////////////////////////
+
+
+
+template <class T>
+class csr_graph {
+	// This class is an immutable compressed sparse row (CSR) snapshot of
+	// a Graph<T>, produced by Graph<T>::freeze(). The edges of node 'i'
+	// are stored at positions offsets[i] to offsets[i + 1] of two parallel
+	// arrays: one holding destinations, one holding metadata. Following
+	// edges only touches the compact destination array, instead of one
+	// heap block per node with the source and metadata of every edge
+	// stored inline.
+	// The arrays are read through pointers, so they can either be owned
+	// by the snapshot (freeze) or live in a memory-mapped snapshot file
+	// (Graph<T>::load_snapshot), which is then traversed in place. A file
+	// without metadata gives every edge the same value.
+public:
+	csr_graph() { this->bind(); }
+
+	csr_graph(const csr_graph& other);
+
+	csr_graph(csr_graph&& other) : csr_graph() { this->swap(other); }
+
+	csr_graph& operator=(csr_graph other) { this->swap(other); return *this; }
+
+	unsigned int node_count() const { return this->nodes; }
+
+	std::size_t edge_count() const { return this->edges; }
+
+	unsigned int degree(unsigned int node) const { return (unsigned int)(this->offset_data[node + 1] - this->offset_data[node]); }
+
+	unsigned int neighbor(unsigned int node, unsigned int i) const { return this->destination_data[this->offset_data[node] + i]; }
+
+	const T& meta(unsigned int node, unsigned int i) const { return this->meta_base[(this->offset_data[node] + i) & this->meta_mask]; }
+
+	// True if the arrays live in a mapped snapshot file
+	bool is_mapped() const { return (bool)this->mapping; }
+
+private:
+	friend class Graph<T>;
+
+	// Point the arrays at the owned vectors (one metadata value means it is shared by every edge)
+	void bind();
+
+	void swap(csr_graph& other);
+
+	std::vector<std::size_t> offsets;
+	std::vector<unsigned int> destinations;
+	std::vector<T> meta_data;
+
+	const std::size_t* offset_data;
+	const unsigned int* destination_data;
+	const T* meta_base;
+	// All ones, or zero when every edge shares meta_base[0]
+	std::size_t meta_mask;
+	unsigned int nodes;
+	std::size_t edges;
+
+	// Snapshot file the arrays were mapped from, if any
+	std::shared_ptr<mapped_file> mapping;
+};
+
+
+
+template <class T>
+csr_graph<T>::csr_graph(const csr_graph& other) : offsets(other.offsets), destinations(other.destinations), meta_data(other.meta_data), mapping(other.mapping) {
+	if (!this->mapping) {
+		this->bind();
+		return;
+	}
+
+	// The copy shares the mapped arrays; only a shared metadata value is owned
+	this->offset_data = other.offset_data;
+	this->destination_data = other.destination_data;
+	this->meta_base = other.meta_mask == 0 ? this->meta_data.data() : other.meta_base;
+	this->meta_mask = other.meta_mask;
+	this->nodes = other.nodes;
+	this->edges = other.edges;
+};
+
+
+
+template <class T>
+void csr_graph<T>::bind() {
+	this->offset_data = this->offsets.data();
+	this->destination_data = this->destinations.data();
+	this->meta_base = this->meta_data.data();
+	this->nodes = this->offsets.empty() ? 0 : (unsigned int)(this->offsets.size() - 1);
+	this->edges = this->destinations.size();
+	this->meta_mask = this->meta_data.size() == this->edges ? ~(std::size_t)0 : 0;
+};
+
+
+
+template <class T>
+void csr_graph<T>::swap(csr_graph& other) {
+	// Swapping vectors keeps their buffers, so the pointers stay valid
+	std::swap(this->offsets, other.offsets);
+	std::swap(this->destinations, other.destinations);
+	std::swap(this->meta_data, other.meta_data);
+	std::swap(this->offset_data, other.offset_data);
+	std::swap(this->destination_data, other.destination_data);
+	std::swap(this->meta_base, other.meta_base);
+	std::swap(this->meta_mask, other.meta_mask);
+	std::swap(this->nodes, other.nodes);
+	std::swap(this->edges, other.edges);
+	std::swap(this->mapping, other.mapping);
+};
+
+
+
+template <class T>
+class list_view {
+	// Read-only view of the vector-of-vectors adjacency list. It has the same
+	// interface as csr_graph<T>, so algorithms can be written once and run
+	// against either layout.
+public:
+	list_view(const adjacency_list<T>& in_list) : adj_list(in_list) {}
+
+	unsigned int node_count() const { return (unsigned int)this->adj_list.size(); }
+
+	unsigned int degree(unsigned int node) const { return (unsigned int)this->adj_list[node].size(); }
+
+	unsigned int neighbor(unsigned int node, unsigned int i) const { return this->adj_list[node][i].destination; }
+
+	const T& meta(unsigned int node, unsigned int i) const { return this->adj_list[node][i].meta(); }
+
+private:
+	const adjacency_list<T>& adj_list;
+};
+
+
+
+  /////////////////////////////////////////////////////////////////////
+ //                      GRAPHS WITHOUT METADATA                    //
+/////////////////////////////////////////////////////////////////////
+
+
+
+// Metadata of graphs whose edges carry none. It is an empty type, so the
+// adjacency list stores only the destination of each edge (4 bytes), and
+// print_graph() prints nothing for it.
+struct no_metadata {};
+
+std::ostream& operator<<(std::ostream& out, const no_metadata&) { return out; }
+
+
+
+// Graph<void> is a graph without edge metadata: the same as Graph<no_metadata>
+template <>
+class Graph<void> : public Graph<no_metadata> {
+public:
+	using Graph<no_metadata>::Graph;
+};
+
+
+
+  /////////////////////////////////////////////////////////////////////
+ //                         MAPPED FILE CLASS                       //
+/////////////////////////////////////////////////////////////////////
+
+
+
+class mapped_file {
+	// This class gives read-only access to the bytes of a file. On POSIX
+	// systems the file is memory-mapped, so nothing is copied and pages
+	// are only read when they are touched. Elsewhere the file is read
+	// into memory with a single read call.
+public:
+	mapped_file() { this->bytes = nullptr; this->length = 0; this->mapped = false; this->writable = false; }
+
+	~mapped_file() { this->close(); }
+
+	mapped_file(const mapped_file&) = delete;
+	mapped_file& operator=(const mapped_file&) = delete;
+
+	// Open a file, returns false if it cannot be read. A file that will be
+	// read front to back is marked 'sequential', so the system reads ahead.
+	bool open(const std::string& path, bool sequential = true);
+
+	void close();
+
+	const char* data() const { return this->bytes; }
+
+	std::size_t size() const { return this->length; }
+
+	// Writable access to the bytes, or nullptr if they cannot be made
+	// writable. The mapping is private, so changes are never written back
+	// to the file: the pages that are written to are copied.
+	char* writable_data();
+
+	// Replace the contents with a copy of 'size' bytes, held in memory
+	void assign(const char* in_bytes, std::size_t size);
+
+private:
+	const char* bytes;
+	std::size_t length;
+	bool mapped;
+	bool writable;
+	// Fallback storage when the file is not memory-mapped
+	std::vector<char> buffer;
+};
+
+
+
+bool mapped_file::open(const std::string& path, bool sequential) {
+	this->close();
+
+#ifndef _WIN32
+	int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0) {
+		return false;
+	}
+	struct stat info;
+	if (fstat(fd, &info) != 0) {
+		::close(fd);
+		return false;
+	}
+	this->length = (std::size_t)info.st_size;
+	if (this->length > 0) {
+		void* addr = mmap(nullptr, this->length, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (addr == MAP_FAILED) {
+			::close(fd);
+			this->length = 0;
+			return false;
+		}
+		if (sequential) {
+			madvise(addr, this->length, MADV_SEQUENTIAL);
+		}
+		this->bytes = (const char*)addr;
+		this->mapped = true;
+	}
+	::close(fd);
+	return true;
+#else
+	std::ifstream file(path, std::ios::binary | std::ios::ate);
+	if (!file) {
+		return false;
+	}
+	this->buffer.resize((std::size_t)file.tellg());
+	file.seekg(0);
+	file.read(this->buffer.data(), this->buffer.size());
+	this->bytes = this->buffer.data();
+	this->length = this->buffer.size();
+	return true;
+#endif
+};
+
+
+
+char* mapped_file::writable_data() {
+#ifndef _WIN32
+	if (this->mapped && !this->writable) {
+		if (mprotect((void*)this->bytes, this->length, PROT_READ | PROT_WRITE) != 0) {
+			return nullptr;
+		}
+		this->writable = true;
+	}
+#endif
+	return (char*)this->bytes;
+};
+
+
+
+void mapped_file::assign(const char* in_bytes, std::size_t size) {
+	std::vector<char> copy(in_bytes, in_bytes + size);
+	this->close();
+	this->buffer.swap(copy);
+	this->bytes = this->buffer.data();
+	this->length = this->buffer.size();
+};
+
+
+
+void mapped_file::close() {
+#ifndef _WIN32
+	if (this->mapped) {
+		munmap((void*)this->bytes, this->length);
+	}
+#endif
+	std::vector<char>().swap(this->buffer);
+	this->bytes = nullptr;
+	this->length = 0;
+	this->mapped = false;
+	this->writable = false;
+};
+
+
+
+  /////////////////////////////////////////////////////////////////////
+ //                         GRAPH SNAPSHOT FILES                    //
+/////////////////////////////////////////////////////////////////////
+
+
+
+// Version of the snapshot format, increased whenever the layout changes
+const std::uint32_t SNAPSHOT_VERSION = 2;
+
+// Snapshot flags: the file holds a maze_graph, and the maze was loaded as an implicit grid
+const std::uint32_t SNAPSHOT_MAZE = 1;
+const std::uint32_t SNAPSHOT_IMPLICIT_GRID = 2;
+
+// Whether snapshots store the metadata of a Graph<T>: byte for byte, so
+// only for trivially copyable types whose bytes mean the same thing in
+// another process. Specialize it to false for types holding handles.
+template <class T>
+struct snapshot_metadata : std::is_trivially_copyable<T> {};
+
+// Sections of a snapshot file, each aligned on SNAPSHOT_ALIGNMENT bytes.
+// ORDER is the original id of every node of a reordered graph (see
+// vertex_order), and empty otherwise.
+enum class snapshot_section { OFFSETS, DESTINATIONS, META, MAZE_TEXT, ROW_START, ROW_LENGTH, ORDER };
+const unsigned int SNAPSHOT_SECTIONS = 7;
+const std::size_t SNAPSHOT_ALIGNMENT = 64;
+
+
+
+struct snapshot_header {
+	// First bytes of a snapshot file. The arrays are stored exactly as
+	// they are laid out in memory, so a snapshot can only be read on a
+	// platform with the same byte order and size_t, and by a Graph<T> with
+	// the same metadata type; the loader checks all of these.
+	char magic[8];
+	std::uint32_t version;
+	// 0x01020304, as written by the machine that saved the file
+	std::uint32_t byte_order;
+	// sizeof(std::size_t) (the offsets), and sizeof(T) or 0 if no metadata is stored
+	std::uint32_t index_size;
+	std::uint32_t meta_size;
+	std::uint32_t flags;
+	std::uint32_t node_count;
+	std::uint64_t edge_count;
+	// Position of every section from the start of the file, and its size in bytes
+	std::uint64_t section_at[SNAPSHOT_SECTIONS];
+	std::uint64_t section_size[SNAPSHOT_SECTIONS];
+	// The maze of a maze_graph (with SNAPSHOT_MAZE)
+	std::uint32_t maze_width;
+	std::uint32_t maze_height;
+	std::uint32_t start_node;
+	std::uint32_t end_node;
+	char search_char;
+	char end_char;
+	char start_char;
+	char padding[5];
+};
+
+
+
+class snapshot_writer {
+	// This class writes a snapshot file: a snapshot_header, then every
+	// section starting on an aligned position, so the arrays can be used
+	// in place once the file is mapped. The header is written last, when
+	// the position and size of every section are known.
+public:
+	snapshot_writer();
+
+	// Create the file, returns false if it cannot be written
+	bool open(const std::string& path);
+
+	// Start a section at the next aligned position
+	void begin(snapshot_section section);
+
+	// Add bytes to the current section
+	void write(const void* data, std::size_t bytes);
+
+	// Write the header and close the file. Returns false if anything failed.
+	bool finish();
+
+	snapshot_header header;
+
+private:
+	std::ofstream file;
+	std::size_t position;
+	int current;
+};
+
+
+
+snapshot_writer::snapshot_writer() {
+	std::memset(&this->header, 0, sizeof(snapshot_header));
+	std::memcpy(this->header.magic, "GRAPHSNP", 8);
+	this->header.version = SNAPSHOT_VERSION;
+	this->header.byte_order = 0x01020304;
+	this->header.index_size = sizeof(std::size_t);
+	this->position = 0;
+	this->current = -1;
+};
+
+
+
+bool snapshot_writer::open(const std::string& path) {
+	this->file.open(path, std::ios::binary | std::ios::trunc);
+	if (!this->file) {
+		std::cerr << "Unable to open output file " << path << std::endl;
+		return false;
+	}
+
+	// Reserve the header
+	this->write(&this->header, sizeof(snapshot_header));
+	return true;
+};
+
+
+
+void snapshot_writer::begin(snapshot_section section) {
+	static const char zeros[SNAPSHOT_ALIGNMENT] = {};
+	this->current = -1;
+	this->write(zeros, (SNAPSHOT_ALIGNMENT - this->position % SNAPSHOT_ALIGNMENT) % SNAPSHOT_ALIGNMENT);
+	this->current = (int)section;
+	this->header.section_at[this->current] = this->position;
+	this->header.section_size[this->current] = 0;
+};
+
+
+
+void snapshot_writer::write(const void* data, std::size_t bytes) {
+	this->file.write((const char*)data, bytes);
+	this->position += bytes;
+	if (this->current >= 0) {
+		this->header.section_size[this->current] += bytes;
+	}
+};
+
+
+
+bool snapshot_writer::finish() {
+	this->file.seekp(0);
+	this->file.write((const char*)&this->header, sizeof(snapshot_header));
+	this->file.close();
+	if (!this->file) {
+		std::cerr << "Unable to write the snapshot file" << std::endl;
+		return false;
+	}
+	return true;
+};
+
+
+
+// Check that a mapped file is a snapshot this build can use in place, with
+// 'meta_size' bytes of metadata per edge (0 for none) aligned on
+// 'meta_align'. Returns its header, or nullptr after printing the problem.
+// Only the sizes are checked, not the edges, so the file must be trusted.
+const snapshot_header* check_snapshot(const mapped_file& file, std::uint32_t meta_size, std::size_t meta_align, const std::string& path) {
+	const snapshot_header* header = (const snapshot_header*)file.data();
+
+	// Every section must be inside the file and aligned
+	auto sections_fit = [&]() {
+		for (unsigned int k = 0; k < SNAPSHOT_SECTIONS; k++) {
+			std::uint64_t at = header->section_at[k];
+			if (at > file.size() || header->section_size[k] > file.size() - at || at % SNAPSHOT_ALIGNMENT != 0) {
+				return false;
+			}
+		}
+		return true;
+	};
+
+	// The graph arrays must hold exactly the nodes and edges of the header
+	auto arrays_fit = [&]() {
+		const std::uint64_t* size = header->section_size;
+		std::uint64_t nodes = header->node_count;
+		if (size[(int)snapshot_section::OFFSETS] != (nodes + 1) * sizeof(std::size_t) || size[(int)snapshot_section::DESTINATIONS] != header->edge_count * sizeof(unsigned int) || size[(int)snapshot_section::META] != header->edge_count * meta_size) {
+			return false;
+		}
+		if (size[(int)snapshot_section::ORDER] != 0 && size[(int)snapshot_section::ORDER] != nodes * sizeof(unsigned int)) {
+			return false;
+		}
+		return ((const std::size_t*)(file.data() + header->section_at[(int)snapshot_section::OFFSETS]))[nodes] == header->edge_count;
+	};
+
+	const char* problem = nullptr;
+	if (file.size() < sizeof(snapshot_header) || std::memcmp(header->magic, "GRAPHSNP", 8) != 0) {
+		problem = "is not a graph snapshot";
+	}
+	else if (header->version != SNAPSHOT_VERSION) {
+		problem = "has an unsupported snapshot version";
+	}
+	else if (header->byte_order != 0x01020304 || header->index_size != sizeof(std::size_t)) {
+		problem = "was written on a different platform";
+	}
+	else if (header->meta_size != meta_size || meta_align > SNAPSHOT_ALIGNMENT) {
+		problem = "has a different metadata type";
+	}
+	else if (!sections_fit() || !arrays_fit()) {
+		problem = "is truncated or corrupt";
+	}
+
+	if (problem != nullptr) {
+		std::cerr << "The file " << path << " " << problem << std::endl;
+		return nullptr;
+	}
+	return header;
+};
+
+
+
+template <class T>
+bool Graph<T>::save_snapshot(const std::string& path) const {
+	snapshot_writer out;
+	if (!out.open(path)) {
+		return false;
+	}
+	this->write_snapshot(out);
+	return out.finish();
+};
+
+
+
+template <class T>
+void Graph<T>::write_snapshot(snapshot_writer& out) const {
+	// Edges per block written to the file
+	const std::size_t BLOCK = 1 << 16;
+
+	this->visit_view([&](const auto& view) {
+		unsigned int nodes = view.node_count();
+
+		// Offsets
+		std::vector<std::size_t> offsets(nodes + 1);
+		offsets[0] = 0;
+		for (unsigned int i = 0; i < nodes; i++) {
+			offsets[i + 1] = offsets[i] + view.degree(i);
+		}
+		out.header.node_count = nodes;
+		out.header.edge_count = offsets[nodes];
+		out.begin(snapshot_section::OFFSETS);
+		out.write(offsets.data(), offsets.size() * sizeof(std::size_t));
+
+		// Destinations, copied in blocks
+		std::vector<unsigned int> block;
+		block.reserve(BLOCK);
+		out.begin(snapshot_section::DESTINATIONS);
+		for (unsigned int i = 0; i < nodes; i++) {
+			for (unsigned int j = 0; j < view.degree(i); j++) {
+				block.push_back(view.neighbor(i, j));
+				if (block.size() == BLOCK) {
+					out.write(block.data(), block.size() * sizeof(unsigned int));
+					block.clear();
+				}
+			}
+		}
+		out.write(block.data(), block.size() * sizeof(unsigned int));
+
+		// Metadata, only if it can be copied byte for byte
+		out.begin(snapshot_section::META);
+		if constexpr (snapshot_metadata<T>::value) {
+			std::vector<T> metas;
+			metas.reserve(BLOCK);
+			out.header.meta_size = sizeof(T);
+			for (unsigned int i = 0; i < nodes; i++) {
+				for (unsigned int j = 0; j < view.degree(i); j++) {
+					metas.push_back(view.meta(i, j));
+					if (metas.size() == BLOCK) {
+						out.write(metas.data(), metas.size() * sizeof(T));
+						metas.clear();
+					}
+				}
+			}
+			out.write(metas.data(), metas.size() * sizeof(T));
+		}
+	});
+
+	// The order of the nodes, so the loaded graph keeps its original ids
+	out.begin(snapshot_section::ORDER);
+	out.write(this->order.sequence().data(), this->order.size() * sizeof(unsigned int));
+};
+
+
+
+template <class T>
+bool Graph<T>::load_snapshot(const std::string& path) {
+	std::shared_ptr<mapped_file> file = std::make_shared<mapped_file>();
+	if (!file->open(path, false)) {
+		std::cerr << "Unable to open snapshot file " << path << std::endl;
+		return false;
+	}
+	const snapshot_header* header = check_snapshot(*file, snapshot_metadata<T>::value ? sizeof(T) : 0, alignof(T), path);
+	if (header == nullptr) {
+		return false;
+	}
+	this->map_snapshot(file, *header, T());
+	return true;
+};
+
+
+
+template <class T>
+void Graph<T>::map_snapshot(const std::shared_ptr<mapped_file>& file, const snapshot_header& header, const T& fill) {
+	const char* base = file->data();
+	csr_graph<T> snapshot;
+	snapshot.offset_data = (const std::size_t*)(base + header.section_at[(int)snapshot_section::OFFSETS]);
+	snapshot.destination_data = (const unsigned int*)(base + header.section_at[(int)snapshot_section::DESTINATIONS]);
+	snapshot.nodes = header.node_count;
+	snapshot.edges = (std::size_t)header.edge_count;
+	if (header.meta_size != 0) {
+		snapshot.meta_base = (const T*)(base + header.section_at[(int)snapshot_section::META]);
+		snapshot.meta_mask = ~(std::size_t)0;
+	}
+	else {
+		snapshot.meta_data.assign(1, fill);
+		snapshot.meta_base = snapshot.meta_data.data();
+		snapshot.meta_mask = 0;
+	}
+	snapshot.mapping = file;
+
+	// The nodes are stored in the order they were frozen in
+	const unsigned int* sequence = (const unsigned int*)(base + header.section_at[(int)snapshot_section::ORDER]);
+	std::size_t ordered = (std::size_t)(header.section_size[(int)snapshot_section::ORDER] / sizeof(unsigned int));
+	if (!this->order.assign(std::vector<unsigned int>(sequence, sequence + ordered))) {
+		std::cerr << "The snapshot has an invalid vertex order, its nodes keep their stored ids" << std::endl;
+	}
+
+	// The snapshot replaces the whole graph, and the indexes built on it
+	this->csr = std::move(snapshot);
+	this->release_edges();
+	this->N = header.node_count;
+	this->frozen = true;
+	this->reverse_valid = false;
+	this->components_valid = false;
+};
+
+
+
+  /////////////////////////////////////////////////////////////////////
+ //                       IMPLICIT GRID VIEW CLASS                  //
+/////////////////////////////////////////////////////////////////////
+
+
+
+class grid_graph {
+	// This class is a graph view of a maze that never materializes an
+	// adjacency list. Each cell is one bit (set if the cell can be walked
+	// on), and the neighbors of a cell are computed on the fly from the
+	// bitmap. Node identifiers are the same as maze_graph uses
+	// (width * row + column), and every open node has four neighbor slots,
+	// in the order left, right, up, down; a slot that is off the grid or
+	// blocked returns NO_NODE. Unlike the adjacency list built by
+	// maze_graph, the grid is undirected: any open cell, including the
+	// start and the end, can be entered from an open neighbor.
+public:
+	grid_graph() { this->width = 0; this->height = 0; }
+
+	// Resize the grid, every cell starts blocked
+	void resize(unsigned int in_width, unsigned int in_height) {
+		this->width = in_width;
+		this->height = in_height;
+		this->cells.assign(((unsigned long long)in_width * in_height + 63) / 64, 0);
+	}
+
+	unsigned int node_count() const { return this->width * this->height; }
+
+	// A blocked cell has no edges
+	unsigned int degree(unsigned int node) const { return this->is_open(node) ? 4 : 0; }
+
+	unsigned int neighbor(unsigned int node, unsigned int i) const {
+		unsigned int next;
+		if (i == 0) {
+			if (node % this->width == 0) return NO_NODE;
+			next = node - 1;
+		}
+		else if (i == 1) {
+			if (node % this->width == this->width - 1) return NO_NODE;
+			next = node + 1;
+		}
+		else if (i == 2) {
+			if (node < this->width) return NO_NODE;
+			next = node - this->width;
+		}
+		else {
+			if (node >= this->node_count() - this->width) return NO_NODE;
+			next = node + this->width;
+		}
+		return this->is_open(next) ? next : NO_NODE;
+	}
+
+	// The grid is undirected, so it is its own reverse graph: incoming edge
+	// 'i' of a node comes from neighbor 'i', through that neighbor's edge
+	// in the opposite direction (left <-> right, up <-> down)
+	unsigned int slot(unsigned int, unsigned int i) const { return i ^ 1; }
+
+	bool is_open(unsigned int node) const { return (this->cells[node / 64] >> (node % 64)) & 1; }
+
+	void set_open(unsigned int node, bool open) {
+		if (open) {
+			this->cells[node / 64] |= 1ULL << (node % 64);
+		}
+		else {
+			this->cells[node / 64] &= ~(1ULL << (node % 64));
+		}
+	}
+
+	unsigned int width;
+	unsigned int height;
+	// One bit per cell, in node order
+	std::vector<unsigned long long> cells;
+};
+
+
+
+  /////////////////////////////////////////////////////////////////////
+ //                       CORRIDOR GRAPH CLASS                      //
+/////////////////////////////////////////////////////////////////////
+
+
+
+class corridor_graph {
+	// This class is the junction graph of a grid maze. Every open cell that
+	// does not sit in the middle of a corridor (a cell with other than two
+	// open neighbors, or one of the terminals, such as the start and the
+	// end) is a node, and every corridor of two-neighbor cells between two
+	// junctions is a single edge, weighted by its length in steps. In a
+	// labyrinth most cells are corridor cells, so the junction graph is
+	// many times smaller than the grid; expand() walks the corridors again
+	// to turn a path of junctions back into a path of cells.
+	// It is a graph view whose metadata is the corridor length, so it can
+	// be searched with Dijkstra and meta_weight<edge_weight<unsigned int>>.
+	// Like grid_graph it is undirected, and so it is its own reverse graph.
+public:
+	// Contract a grid of 'cells' cells. 'neighbors(cell, out)' writes the
+	// open neighbors of a cell to 'out' (at most 4) and returns how many
+	// there are (0 for a blocked cell). The 'terminals' are always junctions.
+	template <class F>
+	void build(unsigned int cells, F neighbors, const std::vector<unsigned int>& terminals);
+
+	void clear() { *this = corridor_graph(); }
+
+	unsigned int node_count() const { return (unsigned int)this->junctions.size(); }
+
+	std::size_t edge_count() const { return this->destinations.size(); }
+
+	unsigned int degree(unsigned int node) const { return (unsigned int)(this->offsets[node + 1] - this->offsets[node]); }
+
+	unsigned int neighbor(unsigned int node, unsigned int i) const { return this->destinations[this->offsets[node] + i]; }
+
+	// Length of corridor 'i' of a junction, in steps
+	const unsigned int& meta(unsigned int node, unsigned int i) const { return this->lengths[this->offsets[node] + i]; }
+
+	// Index of the same corridor in the adjacency of its other end
+	unsigned int slot(unsigned int node, unsigned int i) const { return this->twins[this->offsets[node] + i]; }
+
+	// Cell of a junction, and the junction of a cell (NO_NODE for a cell
+	// inside a corridor, or a blocked one)
+	unsigned int cell(unsigned int node) const { return this->junctions[node]; }
+
+	unsigned int junction(unsigned int cell) const {
+		std::vector<unsigned int>::const_iterator it = std::lower_bound(this->junctions.begin(), this->junctions.end(), cell);
+		return (it != this->junctions.end() && *it == cell) ? (unsigned int)(it - this->junctions.begin()) : NO_NODE;
+	}
+
+	// Turn a path of junctions into the path of cells it stands for,
+	// following the shortest corridor between each pair of junctions.
+	// 'neighbors' must be the function the graph was built with.
+	template <class F>
+	std::vector<unsigned int> expand(const std::vector<unsigned int>& path, F neighbors) const;
+
+private:
+	// Cells of the junctions, in increasing order
+	std::vector<unsigned int> junctions;
+	// The corridors of junction 'i' are stored at positions offsets[i] to
+	// offsets[i + 1]: the junction they lead to, their length, their first
+	// cell and the index of the same corridor seen from its other end
+	std::vector<std::size_t> offsets;
+	std::vector<unsigned int> destinations;
+	std::vector<unsigned int> lengths;
+	std::vector<unsigned int> steps;
+	std::vector<unsigned int> twins;
+};
+
+
+
+template <class F>
+void corridor_graph::build(unsigned int cells, F neighbors, const std::vector<unsigned int>& terminals) {
+	this->clear();
+	unsigned int around[4];
+
+	// Find the junctions
+	std::vector<bool> is_junction(cells, false);
+	for (unsigned int t = 0; t < terminals.size(); t++) {
+		if (terminals[t] < cells) {
+			is_junction[terminals[t]] = true;
+		}
+	}
+	for (unsigned int c = 0; c < cells; c++) {
+		unsigned int count = neighbors(c, around);
+		if (is_junction[c] || (count != 0 && count != 2)) {
+			is_junction[c] = true;
+			this->junctions.push_back(c);
+		}
+	}
+
+	// Walk every corridor out of every junction to the junction at its
+	// other end, remembering the cell before it to pair the two directions.
+	// A corridor that leads back to where it started is dropped.
+	std::vector<unsigned int> lasts;
+	this->offsets.push_back(0);
+	for (unsigned int u = 0; u < this->junctions.size(); u++) {
+		unsigned int first[4];
+		unsigned int count = neighbors(this->junctions[u], first);
+		for (unsigned int k = 0; k < count; k++) {
+			unsigned int prev = this->junctions[u];
+			unsigned int curr = first[k];
+			unsigned int length = 1;
+			while (!is_junction[curr]) {
+				neighbors(curr, around);
+				unsigned int next = around[0] == prev ? around[1] : around[0];
+				prev = curr;
+				curr = next;
+				length++;
+			}
+			if (curr == this->junctions[u]) {
+				continue;
+			}
+			this->destinations.push_back(this->junction(curr));
+			this->lengths.push_back(length);
+			this->steps.push_back(first[k]);
+			lasts.push_back(prev);
+		}
+		this->offsets.push_back(this->destinations.size());
+	}
+
+	// The same corridor seen from its other end starts at the cell the
+	// walk arrived from
+	this->twins.resize(this->destinations.size());
+	for (unsigned int u = 0; u < this->junctions.size(); u++) {
+		for (std::size_t e = this->offsets[u]; e < this->offsets[u + 1]; e++) {
+			unsigned int v = this->destinations[e];
+			for (std::size_t f = this->offsets[v]; f < this->offsets[v + 1]; f++) {
+				if (this->steps[f] == lasts[e] && this->destinations[f] == u) {
+					this->twins[e] = (unsigned int)(f - this->offsets[v]);
+					break;
+				}
+			}
+		}
+	}
+};
+
+
+
+template <class F>
+std::vector<unsigned int> corridor_graph::expand(const std::vector<unsigned int>& path, F neighbors) const {
+	std::vector<unsigned int> cells;
+	if (path.empty()) {
+		return cells;
+	}
+	cells.push_back(this->junctions[path[0]]);
+
+	unsigned int around[4];
+	for (std::size_t k = 0; k + 1 < path.size(); k++) {
+		// Shortest corridor to the next junction
+		std::size_t best = this->offsets[path[k]];
+		for (std::size_t e = best; e < this->offsets[path[k] + 1]; e++) {
+			if (this->destinations[e] == path[k + 1] && (this->destinations[best] != path[k + 1] || this->lengths[e] < this->lengths[best])) {
+				best = e;
+			}
+		}
+
+		// Walk it: every cell inside has exactly two open neighbors
+		unsigned int prev = this->junctions[path[k]];
+		unsigned int curr = this->steps[best];
+		unsigned int goal = this->junctions[path[k + 1]];
+		cells.push_back(curr);
+		while (curr != goal) {
+			neighbors(curr, around);
+			unsigned int next = around[0] == prev ? around[1] : around[0];
+			prev = curr;
+			curr = next;
+			cells.push_back(curr);
+		}
+	}
+	return cells;
+};
+
+
+
+  /////////////////////////////////////////////////////////////////////
+ //                    HIERARCHICAL PATHFINDING CLASS               //
+/////////////////////////////////////////////////////////////////////
+
+
+
+class cluster_graph {
+	// This class answers path queries on a grid_graph with hierarchical
+	// path-finding (HPA*). The grid is split into square tiles, and every
+	// tile caches its entrances (the middle cell of every run of open
+	// cells along one of its borders that faces open cells across it) and
+	// the distances between its entrances inside the tile. The entrances
+	// form an abstract graph: an entrance is linked to the other entrances
+	// of its tile that it reaches, weighted by their distance, and to the
+	// entrance facing it across the border, with a weight of 1. find_path()
+	// joins the start and the end to the entrances of their tiles, searches
+	// the abstract graph, and refines only the tiles along the route back
+	// into cells. The paths cross the borders at the entrances only, so
+	// they are near-shortest rather than shortest.
+	// When a cell changes, invalidate() marks its tile out of date (and the
+	// tile across the border, for a cell on a border), and refresh()
+	// rebuilds only those tiles.
+	// It is a graph view of the abstract graph: node 'tile * slots + i' is
+	// entrance 'i' of a tile, and its edges go to every entrance of the
+	// tile, then across its left, right, top and bottom borders (NO_NODE
+	// where there is no such edge), with their weights as metadata.
+public:
+	cluster_graph() { this->size = 0; this->width = 0; this->height = 0; this->tiles_x = 0; this->slots = 0; this->unit = 1; }
+
+	// Split 'grid' into tiles of 'tile_size' x 'tile_size' cells, and build
+	// every tile on the threads of 'pool'
+	void build(const grid_graph& grid, unsigned int tile_size, worker_pool& pool);
+
+	void clear() { *this = cluster_graph(); }
+
+	// Mark the tiles that a change of 'cell' affects out of date
+	void invalidate(unsigned int cell);
+
+	// Rebuild the tiles that are out of date from 'grid', and return how many there were
+	unsigned int refresh(const grid_graph& grid);
+
+	unsigned int tile_size() const { return this->size; }
+
+	unsigned int tile_count() const { return (unsigned int)this->tiles.size(); }
+
+	std::size_t entrance_count() const;
+
+	unsigned int node_count() const { return (unsigned int)this->tiles.size() * this->slots; }
+
+	unsigned int degree(unsigned int node) const {
+		const tile& t = this->tiles[node / this->slots];
+		return node % this->slots < t.entrances.size() ? (unsigned int)t.entrances.size() + 4 : 0;
+	}
+
+	unsigned int neighbor(unsigned int node, unsigned int i) const;
+
+	const unsigned int& meta(unsigned int node, unsigned int i) const {
+		const tile& t = this->tiles[node / this->slots];
+		return i < t.entrances.size() ? t.distances[(node % this->slots) * t.entrances.size() + i] : this->unit;
+	}
+
+	// Path from 'start_node' to 'end_node' over 'grid' (the grid the tiles
+	// were built from, with no tile out of date), searching the abstract
+	// graph with the Dijkstra of 'engine'. Returns an empty path if there
+	// is no path.
+	template <class E>
+	std::vector<unsigned int> find_path(E& engine, const grid_graph& grid, unsigned int start_node, unsigned int end_node) const;
+
+private:
+	struct tile {
+		// Cells of the entrances, in increasing order, and for each the
+		// borders it crosses (bit 0 left, 1 right, 2 top, 3 bottom)
+		std::vector<unsigned int> entrances;
+		std::vector<unsigned char> links;
+		// Distance from entrance 'a' to entrance 'b' at a * entrances + b
+		// (NO_NODE if 'b' cannot be reached inside the tile)
+		std::vector<unsigned int> distances;
+		bool dirty = true;
+	};
+
+	// The abstract graph with two more nodes: the start, linked to the
+	// entrances of its tile it reaches (and to the end, if it reaches the
+	// end inside its tile), and the end, linked from the entrances of its tile
+	class query_view {
+	public:
+		query_view(const cluster_graph& in_graph, unsigned int in_end_tile) : graph(in_graph), source(in_graph.node_count()), goal(in_graph.node_count() + 1), end_tile(in_end_tile) {}
+
+		unsigned int node_count() const { return this->graph.node_count() + 2; }
+
+		unsigned int degree(unsigned int node) const {
+			if (node == this->source) {
+				return (unsigned int)this->start_links.size();
+			}
+			if (node == this->goal || this->graph.degree(node) == 0) {
+				return 0;
+			}
+			return this->graph.degree(node) + (node / this->graph.slots == this->end_tile ? 1 : 0);
+		}
+
+		unsigned int neighbor(unsigned int node, unsigned int i) const {
+			if (node == this->source) {
+				return this->start_links[i];
+			}
+			if (i < this->graph.degree(node)) {
+				return this->graph.neighbor(node, i);
+			}
+			return this->end_costs[node % this->graph.slots] == NO_NODE ? NO_NODE : this->goal;
+		}
+
+		const unsigned int& meta(unsigned int node, unsigned int i) const {
+			if (node == this->source) {
+				return this->start_costs[i];
+			}
+			if (i < this->graph.degree(node)) {
+				return this->graph.meta(node, i);
+			}
+			return this->end_costs[node % this->graph.slots];
+		}
+
+		const cluster_graph& graph;
+		unsigned int source;
+		unsigned int goal;
+		unsigned int end_tile;
+		std::vector<unsigned int> start_links;
+		std::vector<unsigned int> start_costs;
+		std::vector<unsigned int> end_costs;
+	};
+
+	// Find the entrances of a tile and the distances between them
+	void build_tile(const grid_graph& grid, unsigned int index);
+
+	// Breadth first search from 'cell', without leaving its tile. The
+	// distances and parents are indexed by position within the tile
+	// (row * size + column), NO_NODE for the cells it does not reach.
+	void tile_BFS(const grid_graph& grid, unsigned int cell, std::vector<unsigned int>& distance, std::vector<unsigned int>& parent) const;
+
+	// Cells from the source of a tile_BFS to 'cell', appended to 'path' (without the source)
+	void trace(const std::vector<unsigned int>& parent, unsigned int cell, std::vector<unsigned int>& path) const;
+
+	unsigned int tile_of(unsigned int cell) const { return (cell / this->width / this->size) * this->tiles_x + (cell % this->width) / this->size; }
+
+	unsigned int position(unsigned int cell) const { return (cell / this->width % this->size) * this->size + cell % this->width % this->size; }
+
+	// Cell at a position within tile 'index'
+	unsigned int cell_at(unsigned int index, unsigned int pos) const {
+		return ((index / this->tiles_x) * this->size + pos / this->size) * this->width + (index % this->tiles_x) * this->size + pos % this->size;
+	}
+
+	// Node of the entrance at 'cell' (NO_NODE if it is not an entrance)
+	unsigned int node_of(unsigned int cell) const;
+
+	unsigned int size;
+	unsigned int width;
+	unsigned int height;
+	unsigned int tiles_x;
+	// Node identifiers per tile: a border of 'size' cells has at most
+	// (size + 1) / 2 entrances, so a tile has at most 2 * size + 4
+	unsigned int slots;
+	std::vector<tile> tiles;
+	// Weight of the edges across borders
+	unsigned int unit;
+};
+
+
+
+void cluster_graph::build(const grid_graph& grid, unsigned int tile_size, worker_pool& pool) {
+	this->size = std::max(1u, tile_size);
+	this->width = grid.width;
+	this->height = grid.height;
+	this->tiles_x = (this->width + this->size - 1) / this->size;
+	this->slots = 2 * this->size + 4;
+	unsigned int tiles_y = (this->height + this->size - 1) / this->size;
+	this->tiles.assign((std::size_t)this->tiles_x * tiles_y, tile());
+
+	// The tiles are independent, each thread builds every size()th one
+	pool.run([&](unsigned int index) {
+		for (std::size_t t = index; t < this->tiles.size(); t += pool.size()) {
+			this->build_tile(grid, (unsigned int)t);
+		}
+	});
+};
+
+
+
+void cluster_graph::invalidate(unsigned int cell) {
+	if (this->tiles.empty() || cell >= this->width * this->height) {
+		return;
+	}
+	unsigned int index = this->tile_of(cell);
+	unsigned int row = cell / this->width;
+	unsigned int col = cell % this->width;
+	this->tiles[index].dirty = true;
+
+	// A cell on a border also changes the entrances across it
+	if (col % this->size == 0 && col > 0) {
+		this->tiles[index - 1].dirty = true;
+	}
+	if (col % this->size == this->size - 1 && col + 1 < this->width) {
+		this->tiles[index + 1].dirty = true;
+	}
+	if (row % this->size == 0 && row > 0) {
+		this->tiles[index - this->tiles_x].dirty = true;
+	}
+	if (row % this->size == this->size - 1 && row + 1 < this->height) {
+		this->tiles[index + this->tiles_x].dirty = true;
+	}
+};
+
+
+
+unsigned int cluster_graph::refresh(const grid_graph& grid) {
+	unsigned int rebuilt = 0;
+	for (unsigned int t = 0; t < this->tiles.size(); t++) {
+		if (this->tiles[t].dirty) {
+			this->build_tile(grid, t);
+			rebuilt++;
+		}
+	}
+	return rebuilt;
+};
+
+
+
+std::size_t cluster_graph::entrance_count() const {
+	std::size_t count = 0;
+	for (unsigned int t = 0; t < this->tiles.size(); t++) {
+		count += this->tiles[t].entrances.size();
+	}
+	return count;
+};
+
+
+
+unsigned int cluster_graph::neighbor(unsigned int node, unsigned int i) const {
+	unsigned int index = node / this->slots;
+	unsigned int a = node % this->slots;
+	const tile& t = this->tiles[index];
+	unsigned int entrances = (unsigned int)t.entrances.size();
+
+	// Another entrance of the tile
+	if (i < entrances) {
+		return (i == a || t.distances[a * entrances + i] == NO_NODE) ? NO_NODE : index * this->slots + i;
+	}
+
+	// The entrance across a border
+	unsigned int side = i - entrances;
+	if (!((t.links[a] >> side) & 1)) {
+		return NO_NODE;
+	}
+	unsigned int cell = t.entrances[a];
+	unsigned int across = side == 0 ? cell - 1 : side == 1 ? cell + 1 : side == 2 ? cell - this->width : cell + this->width;
+	return this->node_of(across);
+};
+
+
+
+unsigned int cluster_graph::node_of(unsigned int cell) const {
+	unsigned int index = this->tile_of(cell);
+	const std::vector<unsigned int>& entrances = this->tiles[index].entrances;
+	std::vector<unsigned int>::const_iterator it = std::lower_bound(entrances.begin(), entrances.end(), cell);
+	return (it != entrances.end() && *it == cell) ? index * this->slots + (unsigned int)(it - entrances.begin()) : NO_NODE;
+};
+
+
+
+void cluster_graph::build_tile(const grid_graph& grid, unsigned int index) {
+	tile& t = this->tiles[index];
+	unsigned int x0 = (index % this->tiles_x) * this->size;
+	unsigned int y0 = (index / this->tiles_x) * this->size;
+	unsigned int x1 = std::min(x0 + this->size, this->width);
+	unsigned int y1 = std::min(y0 + this->size, this->height);
+
+	// Runs of cells open on both sides of a border, where 'inside(k)' and
+	// 'outside(k)' are the two cells at position k along it. The tile
+	// across the border finds the same runs, so both pick the same middle.
+	std::vector<std::pair<unsigned int, unsigned char>> found;
+	auto scan = [&](unsigned int length, auto inside, auto outside, unsigned char side) {
+		unsigned int k = 0;
+		while (k < length) {
+			unsigned int first = k;
+			while (k < length && grid.is_open(inside(k)) && grid.is_open(outside(k))) {
+				k++;
+			}
+			if (k == first) {
+				k++;
+				continue;
+			}
+			found.push_back(std::make_pair(inside((first + k - 1) / 2), side));
+		}
+	};
+	unsigned int w = this->width;
+	if (x0 > 0) {
+		scan(y1 - y0, [&](unsigned int k) { return (y0 + k) * w + x0; }, [&](unsigned int k) { return (y0 + k) * w + x0 - 1; }, 1);
+	}
+	if (x1 < this->width) {
+		scan(y1 - y0, [&](unsigned int k) { return (y0 + k) * w + x1 - 1; }, [&](unsigned int k) { return (y0 + k) * w + x1; }, 2);
+	}
+	if (y0 > 0) {
+		scan(x1 - x0, [&](unsigned int k) { return y0 * w + x0 + k; }, [&](unsigned int k) { return (y0 - 1) * w + x0 + k; }, 4);
+	}
+	if (y1 < this->height) {
+		scan(x1 - x0, [&](unsigned int k) { return (y1 - 1) * w + x0 + k; }, [&](unsigned int k) { return y1 * w + x0 + k; }, 8);
+	}
+
+	// A corner cell can be the entrance of two borders
+	std::sort(found.begin(), found.end());
+	t.entrances.clear();
+	t.links.clear();
+	for (std::size_t i = 0; i < found.size(); i++) {
+		if (!t.entrances.empty() && t.entrances.back() == found[i].first) {
+			t.links.back() |= found[i].second;
+			continue;
+		}
+		t.entrances.push_back(found[i].first);
+		t.links.push_back(found[i].second);
+	}
+
+	// Distances between the entrances, inside the tile
+	std::size_t entrances = t.entrances.size();
+	t.distances.assign(entrances * entrances, NO_NODE);
+	std::vector<unsigned int> distance;
+	std::vector<unsigned int> parent;
+	for (std::size_t a = 0; a < entrances; a++) {
+		this->tile_BFS(grid, t.entrances[a], distance, parent);
+		for (std::size_t b = 0; b < entrances; b++) {
+			t.distances[a * entrances + b] = distance[this->position(t.entrances[b])];
+		}
+	}
+	t.dirty = false;
+};
+
+
+
+void cluster_graph::tile_BFS(const grid_graph& grid, unsigned int cell, std::vector<unsigned int>& distance, std::vector<unsigned int>& parent) const {
+	unsigned int index = this->tile_of(cell);
+	unsigned int x0 = (index % this->tiles_x) * this->size;
+	unsigned int y0 = (index / this->tiles_x) * this->size;
+	unsigned int cols = std::min(this->size, this->width - x0);
+	unsigned int rows = std::min(this->size, this->height - y0);
+	distance.assign(this->size * this->size, NO_NODE);
+	parent.assign(this->size * this->size, NO_NODE);
+
+	std::vector<unsigned int> queue;
+	unsigned int pos = this->position(cell);
+	distance[pos] = 0;
+	parent[pos] = pos;
+	queue.push_back(pos);
+	for (std::size_t head = 0; head < queue.size(); head++) {
+		unsigned int curr = queue[head];
+		unsigned int row = curr / this->size;
+		unsigned int col = curr % this->size;
+		unsigned int next[4];
+		unsigned int count = 0;
+		if (col > 0) next[count++] = curr - 1;
+		if (col + 1 < cols) next[count++] = curr + 1;
+		if (row > 0) next[count++] = curr - this->size;
+		if (row + 1 < rows) next[count++] = curr + this->size;
+		for (unsigned int k = 0; k < count; k++) {
+			if (distance[next[k]] == NO_NODE && grid.is_open(this->cell_at(index, next[k]))) {
+				distance[next[k]] = distance[curr] + 1;
+				parent[next[k]] = curr;
+				queue.push_back(next[k]);
+			}
+		}
+	}
+};
+
+
+
+void cluster_graph::trace(const std::vector<unsigned int>& parent, unsigned int cell, std::vector<unsigned int>& path) const {
+	unsigned int index = this->tile_of(cell);
+	std::size_t first = path.size();
+	for (unsigned int pos = this->position(cell); parent[pos] != pos; pos = parent[pos]) {
+		path.push_back(this->cell_at(index, pos));
+	}
+	std::reverse(path.begin() + first, path.end());
+};
+
+
+
+template <class E>
+std::vector<unsigned int> cluster_graph::find_path(E& engine, const grid_graph& grid, unsigned int start_node, unsigned int end_node) const {
+	std::vector<unsigned int> path;
+	if (this->tiles.empty() || start_node >= grid.node_count() || end_node >= grid.node_count() || !grid.is_open(start_node) || !grid.is_open(end_node)) {
+		return path;
+	}
+
+	// Join the start and the end to the entrances of their tiles
+	unsigned int start_tile = this->tile_of(start_node);
+	unsigned int end_tile = this->tile_of(end_node);
+	std::vector<unsigned int> start_distance;
+	std::vector<unsigned int> start_parent;
+	std::vector<unsigned int> end_distance;
+	std::vector<unsigned int> end_parent;
+	this->tile_BFS(grid, start_node, start_distance, start_parent);
+	this->tile_BFS(grid, end_node, end_distance, end_parent);
+
+	query_view view(*this, end_tile);
+	const tile& first_tile = this->tiles[start_tile];
+	for (unsigned int a = 0; a < first_tile.entrances.size(); a++) {
+		unsigned int d = start_distance[this->position(first_tile.entrances[a])];
+		if (d != NO_NODE) {
+			view.start_links.push_back(start_tile * this->slots + a);
+			view.start_costs.push_back(d);
+		}
+	}
+	if (start_tile == end_tile && start_distance[this->position(end_node)] != NO_NODE) {
+		view.start_links.push_back(view.goal);
+		view.start_costs.push_back(start_distance[this->position(end_node)]);
+	}
+	const tile& last_tile = this->tiles[end_tile];
+	view.end_costs.assign(this->slots, NO_NODE);
+	for (unsigned int a = 0; a < last_tile.entrances.size(); a++) {
+		view.end_costs[a] = end_distance[this->position(last_tile.entrances[a])];
+	}
+
+	// Search the abstract graph
+	std::vector<unsigned int> route = engine.Dijkstra(view, view.source, view.goal, meta_weight<edge_weight<unsigned int>>());
+	if (route.empty()) {
+		return path;
+	}
+
+	// Refine the route into cells: the first and last tiles with the
+	// searches above, each tile in between with a search of its own, and
+	// one step across every border
+	path.push_back(start_node);
+	if (route.size() == 2) {
+		this->trace(start_parent, end_node, path);
+		return path;
+	}
+	this->trace(start_parent, this->tiles[route[1] / this->slots].entrances[route[1] % this->slots], path);
+	std::vector<unsigned int> distance;
+	std::vector<unsigned int> parent;
+	for (std::size_t k = 1; k + 2 < route.size(); k++) {
+		unsigned int from = this->tiles[route[k] / this->slots].entrances[route[k] % this->slots];
+		unsigned int to = this->tiles[route[k + 1] / this->slots].entrances[route[k + 1] % this->slots];
+		if (route[k] / this->slots != route[k + 1] / this->slots) {
+			path.push_back(to);
+			continue;
+		}
+		this->tile_BFS(grid, from, distance, parent);
+		this->trace(parent, to, path);
+	}
+
+	// The last tile was searched from the end, so its path is reversed
+	std::vector<unsigned int> tail;
+	this->trace(end_parent, this->tiles[route[route.size() - 2] / this->slots].entrances[route[route.size() - 2] % this->slots], tail);
+	if (!tail.empty()) {
+		tail.pop_back();
+		path.insert(path.end(), tail.rbegin(), tail.rend());
+		path.push_back(end_node);
+	}
+	return path;
+};
+
+
+
+  /////////////////////////////////////////////////////////////////////
+ //                       DISTANCE FIELD CLASS                      //
+/////////////////////////////////////////////////////////////////////
+
+
+
+class distance_field {
+	// This class answers path queries to a fixed set of targets (such as
+	// the exit of a maze) from any start, without searching. One breadth
+	// first search from all the targets at once records, for every node,
+	// its hop distance to the nearest target modulo 3, in two bits (with
+	// the fourth value for the nodes that reach no target). On an
+	// undirected view, the neighbors of a node are at most one hop nearer
+	// to a target or farther from it, so the three values tell them apart:
+	// path() just steps to a neighbor one value lower until it reaches a
+	// target, in time proportional to the length of the path. The paths
+	// are shortest paths to the nearest target.
+public:
+	distance_field() { this->nodes = 0; }
+
+	// Search from 'in_targets' over an undirected view (such as a
+	// grid_graph). Targets outside of the view reach nothing.
+	template <class G>
+	void build(const G& view, const std::vector<unsigned int>& in_targets);
+
+	void clear() { *this = distance_field(); }
+
+	unsigned int node_count() const { return this->nodes; }
+
+	// Targets the field was built from, sorted and without duplicates
+	const std::vector<unsigned int>& targets() const { return this->goals; }
+
+	bool is_target(unsigned int node) const {
+		return node < this->nodes && std::binary_search(this->goals.begin(), this->goals.end(), node);
+	}
+
+	// Whether a target can be reached from 'node'
+	bool reaches(unsigned int node) const { return node < this->nodes && this->code(node) != UNREACHED; }
+
+	// Path from 'start_node' to its nearest target over 'view' (the view
+	// the field was built on, unchanged since). Returns an empty path if
+	// no target can be reached.
+	template <class G>
+	std::vector<unsigned int> path(const G& view, unsigned int start_node) const;
+
+private:
+	static const unsigned int UNREACHED = 3;
+
+	unsigned int code(unsigned int node) const { return (this->codes[node / 32] >> (node % 32 * 2)) & 3; }
+
+	void set_code(unsigned int node, unsigned int value) {
+		unsigned int shift = node % 32 * 2;
+		this->codes[node / 32] = (this->codes[node / 32] & ~(3ULL << shift)) | ((unsigned long long)value << shift);
+	}
+
+	unsigned int nodes;
+	std::vector<unsigned int> goals;
+	// Two bits per node, in node order
+	std::vector<unsigned long long> codes;
+};
+
+
+
+template <class G>
+void distance_field::build(const G& view, const std::vector<unsigned int>& in_targets) {
+	this->nodes = view.node_count();
+	this->goals = in_targets;
+	std::sort(this->goals.begin(), this->goals.end());
+	this->goals.erase(std::unique(this->goals.begin(), this->goals.end()), this->goals.end());
+	this->codes.assign(((unsigned long long)this->nodes + 31) / 32, ~0ULL);
+
+	// Expand every target at once, one level at a time
+	std::vector<unsigned int> frontier;
+	std::vector<unsigned int> next;
+	for (unsigned int goal : this->goals) {
+		if (goal < this->nodes) {
+			this->set_code(goal, 0);
+			frontier.push_back(goal);
+		}
+	}
+	for (unsigned int level = 1; !frontier.empty(); level++) {
+		next.clear();
+		for (unsigned int node : frontier) {
+			for (unsigned int i = 0; i < view.degree(node); i++) {
+				unsigned int neighbor = view.neighbor(node, i);
+				if (neighbor < this->nodes && this->code(neighbor) == UNREACHED) {
+					this->set_code(neighbor, level % 3);
+					next.push_back(neighbor);
+				}
+			}
+		}
+		frontier.swap(next);
+	}
+};
+
+
+
+template <class G>
+std::vector<unsigned int> distance_field::path(const G& view, unsigned int start_node) const {
+	std::vector<unsigned int> path;
+	if (!this->reaches(start_node)) {
+		return path;
+	}
+
+	// Every step gets one hop nearer, so a path never has more steps than
+	// there are nodes (unless the view changed since the field was built)
+	unsigned int node = start_node;
+	path.push_back(node);
+	while (this->code(node) != 0 || !this->is_target(node)) {
+		unsigned int nearer = (this->code(node) + 2) % 3;
+		unsigned int next = NO_NODE;
+		for (unsigned int i = 0; i < view.degree(node) && next == NO_NODE; i++) {
+			unsigned int neighbor = view.neighbor(node, i);
+			if (neighbor < this->nodes && this->code(neighbor) == nearer) {
+				next = neighbor;
+			}
+		}
+		if (next == NO_NODE || path.size() > this->nodes) {
+			return std::vector<unsigned int>();
+		}
+		node = next;
+		path.push_back(node);
+	}
+	return path;
+};
+
+
+
+  /////////////////////////////////////////////////////////////////////
+ //                        INTERNED STRING CLASSES                  //
+/////////////////////////////////////////////////////////////////////
+
+
+
+class string_pool {
+	// This class stores every distinct string once and numbers them, so
+	// metadata can refer to a string by a 4-byte index instead of holding
+	// its own copy. Strings are never removed, and a reference to a pooled
+	// string stays valid for the life of the pool. Index 0 is the empty
+	// string. The pool is safe to use from several threads.
+public:
+	string_pool() { this->strings.push_back(std::string()); this->index[std::string()] = 0; }
+
+	// Pool shared by every interned_string
+	static string_pool& shared() {
+		static string_pool pool;
+		return pool;
+	}
+
+	// Index of a string, adding it to the pool if it is new
+	unsigned int intern(const std::string& text);
+
+	const std::string& at(unsigned int id);
+
+	std::size_t size() {
+		std::lock_guard<std::mutex> guard(this->lock);
+		return this->strings.size();
+	}
+
+private:
+	std::mutex lock;
+	// A deque never moves its elements, so references to them stay valid
+	std::deque<std::string> strings;
+	std::unordered_map<std::string, unsigned int> index;
+};
+
+
+
+unsigned int string_pool::intern(const std::string& text) {
+	if (text.empty()) {
+		return 0;
+	}
+	std::lock_guard<std::mutex> guard(this->lock);
+	auto found = this->index.find(text);
+	if (found != this->index.end()) {
+		return found->second;
+	}
+	unsigned int id = (unsigned int)this->strings.size();
+	this->strings.push_back(text);
+	this->index[text] = id;
+	return id;
+};
+
+
+
+const std::string& string_pool::at(unsigned int id) {
+	std::lock_guard<std::mutex> guard(this->lock);
+	return this->strings[id];
+};
+
+
+
+class interned_string {
+	// This class is a string kept in string_pool::shared(), held as its
+	// 4-byte index. Equal strings share one copy, copying one copies the
+	// index, and metadata holding interned strings stays trivially
+	// copyable. Index 0 is the empty string, so an empty interned_string
+	// never touches the pool.
+public:
+	interned_string() { this->id = 0; }
+
+	interned_string(const std::string& text) { this->id = string_pool::shared().intern(text); }
+
+	interned_string(const char* text) { this->id = string_pool::shared().intern(text); }
+
+	const std::string& str() const {
+		static const std::string empty_string;
+		return this->id == 0 ? empty_string : string_pool::shared().at(this->id);
+	}
+
+	operator const std::string&() const { return this->str(); }
+
+	bool empty() const { return this->id == 0; }
+
+	void clear() { this->id = 0; }
+
+	// Index of the string in the pool
+	unsigned int index() const { return this->id; }
+
+	bool operator==(const interned_string& other) const { return this->id == other.id; }
+
+	bool operator!=(const interned_string& other) const { return this->id != other.id; }
+
+private:
+	unsigned int id;
+};
+
+
+
+std::ostream& operator<<(std::ostream& out, const interned_string& text) { return out << text.str(); }
+
+
+
+  /////////////////////////////////////////////////////////////////////
+ //                           ROW SCANNER                           //
+/////////////////////////////////////////////////////////////////////
+
+
+
+// Set bit j of 'mask' (64 characters to a word, bit 0 first) for every
+// text[j] equal to 'a' or 'b', with j < length. Bits are only ever set,
+// so the words must start cleared. With AVX2 (or SSE2, which every x86-64
+// compiler enables) 32 (or 16) characters are compared per instruction;
+// defining GRAPH_NO_SIMD, or any other target, uses the scalar loop.
+void match_row(const char* text, unsigned int length, char a, char b, unsigned long long* mask) {
+	unsigned int j = 0;
+#if defined(__AVX2__) && !defined(GRAPH_NO_SIMD)
+	const __m256i key_a = _mm256_set1_epi8(a);
+	const __m256i key_b = _mm256_set1_epi8(b);
+	for (; j + 32 <= length; j += 32) {
+		__m256i chunk = _mm256_loadu_si256((const __m256i*)(text + j));
+		__m256i hits = _mm256_or_si256(_mm256_cmpeq_epi8(chunk, key_a), _mm256_cmpeq_epi8(chunk, key_b));
+		mask[j / 64] |= (unsigned long long)(unsigned int)_mm256_movemask_epi8(hits) << (j % 64);
+	}
+#elif (defined(__SSE2__) || defined(_M_X64)) && !defined(GRAPH_NO_SIMD)
+	const __m128i key_a = _mm_set1_epi8(a);
+	const __m128i key_b = _mm_set1_epi8(b);
+	for (; j + 16 <= length; j += 16) {
+		__m128i chunk = _mm_loadu_si128((const __m128i*)(text + j));
+		__m128i hits = _mm_or_si128(_mm_cmpeq_epi8(chunk, key_a), _mm_cmpeq_epi8(chunk, key_b));
+		mask[j / 64] |= (unsigned long long)(unsigned int)_mm_movemask_epi8(hits) << (j % 64);
+	}
+#endif
+	for (; j < length; j++) {
+		if (text[j] == a || text[j] == b) {
+			mask[j / 64] |= 1ULL << (j % 64);
+		}
+	}
 };
 
 
@@ -165,14 +5462,30 @@ public:
 
 
 
-// Struct to hold metadata for the maze_graph class
+// Struct to hold metadata for the maze_graph class. The string is
+// interned, so the struct is 8 bytes and trivially copyable.
 struct T_MetaData {
 	int int_data;
-	std::string string_data;
+	interned_string string_data;
+};
+
+
+
+// The weight of a maze_graph edge is its int_data
+template <>
+struct edge_weight<T_MetaData> {
+	int operator()(const T_MetaData& meta) const { return meta.int_data; }
 };
 
 
 
+// Interned string indexes only mean something to the process that interned
+// them, so snapshots do not store T_MetaData
+template <>
+struct snapshot_metadata<T_MetaData> : std::false_type {};
+
+
+
 // Derived class implementing the maze problem (with user-defined struct as metadata template parameter)
 class maze_graph : public Graph<T_MetaData> {
 	// This is the derived class that inherits from the abstract
@@ -192,52 +5505,207 @@ public:
 		this->search_char = in_search_char;
 		this->end_char = in_end_char;
 		this->start_char = in_start_char;
+		this->frozen = false;
+		this->algorithm = search_algorithm::DFS;
+		this->start_node = NO_NODE;
+		this->end_node = NO_NODE;
+		this->maze_width = 0;
+		this->maze_height = 0;
+		this->implicit_grid = false;
+		this->contract_corridors = false;
+		this->hierarchical = false;
+		this->tile_size = 32;
+		this->goal_field = false;
+		this->wall_char = '#';
 
 		this->adj_list.resize(size);
 		this->N = size;
-		for (unsigned int i = 0; i < in_vec.size(); i++) {
-			this->add_edge(in_vec[i]);
-		}
+		this->add_edges(std::move(in_vec));
 	}
 	
-	maze_graph(char in_search_char, char in_end_char, char in_start_char) {
+	maze_graph(char in_search_char, char in_end_char, char in_start_char, std::pmr::memory_resource* resource = std::pmr::get_default_resource()) : Graph<T_MetaData>(resource) {
 		this->search_char = in_search_char;
 		this->end_char = in_end_char;
 		this->start_char = in_start_char;
 		this->N = 0;
+		this->frozen = false;
+		this->algorithm = search_algorithm::DFS;
+		this->start_node = NO_NODE;
+		this->end_node = NO_NODE;
+		this->maze_width = 0;
+		this->maze_height = 0;
+		this->implicit_grid = false;
+		this->contract_corridors = false;
+		this->hierarchical = false;
+		this->tile_size = 32;
+		this->goal_field = false;
+		this->wall_char = '#';
 	}
 
 	maze_graph() {
-		this->N = 0; 
+		this->N = 0;
+		this->frozen = false;
+		this->algorithm = search_algorithm::DFS;
+		this->start_node = NO_NODE;
+		this->end_node = NO_NODE;
+		this->maze_width = 0;
+		this->maze_height = 0;
+		this->implicit_grid = false;
+		this->contract_corridors = false;
+		this->hierarchical = false;
+		this->tile_size = 32;
+		this->goal_field = false;
+		this->wall_char = '#';
 		this->search_char = '\0';
 		this->end_char = '\0';
 		this->start_char = '\0';
 	}
 
 	void print_graph() {
-		for (unsigned int i = 0; i < this->adj_list.size(); i++) {
-			for (unsigned int j = 0; j < this->adj_list[i].size(); j++) {
-				std::cout << "Source: " << this->adj_list[i][j].source << " Destination: " << this->adj_list[i][j].destination << " Metadata: " << this->adj_list[i][j].meta_data.int_data << " " << this->adj_list[i][j].meta_data.string_data << std::endl;
+		// An implicit grid has no metadata, only edges between open cells
+		if (this->implicit_grid) {
+			for (unsigned int i = 0; i < this->grid.node_count(); i++) {
+				for (unsigned int j = 0; this->grid.is_open(i) && j < this->grid.degree(i); j++) {
+					if (this->grid.neighbor(i, j) != NO_NODE) {
+						std::cout << "Source: " << i << " Destination: " << this->grid.neighbor(i, j) << std::endl;
+					}
+				}
 			}
+			return;
 		}
+		this->visit_view([this](const auto& view) {
+			for (unsigned int i = 0; i < view.node_count(); i++) {
+				unsigned int node = this->order.new_id(i);
+				for (unsigned int j = 0; j < view.degree(node); j++) {
+					std::cout << "Source: " << i << " Destination: " << this->order.old_id(view.neighbor(node, j)) << " Metadata: " << view.meta(node, j).int_data << " " << view.meta(node, j).string_data << std::endl;
+				}
+			}
+		});
 	}
 
 
-	// Load the graph from an input file (OVERRIDE)
+	// Load the graph from "maze.txt" and echo the maze (OVERRIDE)
 	void load_graph();
-	
 
-	// Search algorithm to find a path through the maze (OVERRIDE)
-	std::list<unsigned int> run_algorithm(unsigned int start_node, unsigned int end_node);
 
+	// Load the graph from any maze file. The file is memory-mapped, the row
+	// boundaries are found in parallel and the edges are built in row bands
+	// on 'threads' threads (0 = one per hardware thread). The maze is only
+	// printed if 'echo' is set. If 'implicit_grid' is set, no adjacency
+	// list is built, only the one bit per cell 'grid'. Returns false if the
+	// file could not be opened, leaving the maze loaded before untouched.
+	bool load_graph(const std::string& path, bool echo = false, unsigned int threads = 0);
+
+
+	// Write the loaded maze to a snapshot file: its graph (see
+	// Graph<T>::save_snapshot), its size, start and end nodes and
+	// characters, and the maze text. T_MetaData holds interned strings,
+	// so the metadata is not stored, and only mazes whose edges are as
+	// load_graph builds them (int_data 1, no string_data) can be saved.
+	bool save_snapshot(const std::string& path) const;
+
+	// Load a maze snapshot instead of a maze file. The file is
+	// memory-mapped and used as it is: the graph is its frozen CSR
+	// snapshot, and cell(), print_maze() and the JPS grid read the maze
+	// text stored in it, so nothing is parsed. A snapshot of an implicit
+	// grid rebuilds the grid bitmap on 'threads' threads (0 = one per
+	// hardware thread).
+	bool load_snapshot(const std::string& path, unsigned int threads = 0);
+
+
+	// Change the character at (row, col), and update the graph (the
+	// adjacency list or the grid, and the grid the planner searches) to
+	// match, in time proportional to the edges of the cell and its four
+	// neighbors. The maze file is never written: the first change copies
+	// the pages it touches. Returns false outside of the maze.
+	bool set_cell(unsigned int row, unsigned int col, char c);
+
+	// Turn a path cell into a wall (wall_char) or any other cell into a
+	// path cell. The start and end cells cannot be toggled.
+	bool toggle_cell(unsigned int row, unsigned int col);
+
+
+	// Plan a path on the grid with the incremental planner (see
+	// dstar_lite), building the grid first if the maze was loaded into an
+	// adjacency list. After cells change with set_cell or toggle_cell,
+	// repair_path() returns the new path, only searching again the cells
+	// the changes affect; move the planner's start with planner.move_start().
+	graph_path plan_path(unsigned int start_node, unsigned int end_node);
+
+	graph_path repair_path() { return this->planner.repair(this->grid); }
+
+
+	// Every end cell of the maze (holding end_char), in node order: the
+	// targets of a distance field to all the exits (see 'goal_cells')
+	std::vector<unsigned int> exit_cells() const;
+
+
+	// Character at (row, col), or '\0' outside of the maze
+	char cell(unsigned int row, unsigned int col) const {
+		if (row >= this->maze_height || col >= this->row_length[row]) {
+			return '\0';
+		}
+		return this->maze_file->data()[this->row_start[row] + col];
+	}
+
+
+	// Search algorithm to find a path through the maze (OVERRIDE).
+	// Uses the algorithm selected by the 'algorithm' member.
+	graph_path run_algorithm(unsigned int start_node, unsigned int end_node);
 
-	// Depth first search algorithm
-	std::list<unsigned int> DFS(std::stack<unsigned int> in_stack, std::list<unsigned int> path, unsigned int end_node);
+
+	// Answer a batch of path queries on the threads of 'runner', with the
+	// algorithm selected by the 'algorithm' member. Unlike run_algorithm,
+	// the queries do not share any search state, so they run concurrently.
+	path_batch run_queries(batch_runner& runner, const std::vector<path_query>& queries);
+
+
+	// Build what the selected algorithm needs before searching: the grid
+	// for JPS, the incoming edges for the bidirectional searches, the
+	// junction graph if 'contract_corridors' is set, the tiles if
+	// 'hierarchical' is set, the distance field if 'goal_field' is set,
+	// and the component index. run_algorithm and run_queries call it themselves;
+	// call it first to keep the one-time setup out of a timed search.
+	void prepare_search();
 
 
 	// Print the new, solved maze
-	void print_maze(std::list<unsigned int>);
+	void print_maze(const graph_path& path) const;
+
+
+	// Write the maze with the path marked by '+' (except on the start and
+	// end cells) to a stream or a file. The path is marked in a bitmap over
+	// the cells, and the rows are copied into a buffer that is written in
+	// large blocks, so this is linear in the size of the maze.
+	void render_maze(const graph_path& path, std::ostream& out) const;
+
+	bool save_maze(const graph_path& path, const std::string& file_path) const;
+
+
+private:
+	// Find a path with the selected algorithm, using the buffers of
+	// 'engine'. Only reads the graph (after prepare_search), so several
+	// threads can search at once, each with its own engine. Returns no
+	// path at once if the component index rules the query out.
+	template <class E>
+	std::vector<unsigned int> find_path(E& engine, unsigned int start_node, unsigned int end_node) const;
+
+	// Build the adjacency list (or the implicit grid) from the loaded maze file
+	void build_edges(unsigned int threads);
+
+	void build_grid(unsigned int threads);
+
+	// Nodes the edges of the cell at (row, col) lead to, in the order
+	// left, right, up, down: the path and end cells next to a path or
+	// start cell. Returns how many were written to 'neighbors' (at most 4).
+	unsigned int cell_edges(unsigned int row, unsigned int col, unsigned int* neighbors) const;
+
+	// Open cells (path, start and end cells) next to an open cell, in the
+	// same order, ignoring which way the edges go. Returns 0 for a cell
+	// that is not open.
+	unsigned int open_cells(unsigned int node, unsigned int* neighbors) const;
 
+public:
 
 	// MEMBERS UNIQUE TO THE DERIVED CLASS
 	// 'Path' character to follow, in the maze
@@ -250,10 +5718,59 @@ public:
 	unsigned int start_node;
 	// Integer identifier of the ending node
 	unsigned int end_node;
-	// Width of the maze
+	// Width of the maze (length of its longest row)
 	unsigned int maze_width;
-	// Vector that stores the maze after it is read from a file
-	std::vector<std::vector<char>> maze;
+	// Height of the maze (number of rows)
+	unsigned int maze_height;
+	// Algorithm used by run_algorithm (DFS by default)
+	search_algorithm algorithm;
+	// Set before load_graph to search an implicit grid instead of an adjacency list
+	bool implicit_grid;
+	// Set to search the junction graph of the maze (see corridor_graph)
+	// instead of every cell: DFS runs on it as it is, and every other
+	// algorithm as Dijkstra on the corridor lengths, so the paths are
+	// still shortest paths. Like the implicit grid, the junction graph is
+	// undirected, so a path between two other cells may cross the start or
+	// the end cell. Queries from or to a cell inside a corridor search the
+	// cells as usual.
+	bool contract_corridors;
+	// Junction graph of the maze, built on the first search with 'contract_corridors' set
+	corridor_graph corridors;
+	// Set to answer queries with hierarchical path-finding over tiles of
+	// 'tile_size' x 'tile_size' cells (see cluster_graph), on the grid. The
+	// paths are near-shortest. Takes precedence over 'contract_corridors'.
+	bool hierarchical;
+	unsigned int tile_size;
+	// Tiles of the hierarchical search, built on its first search and
+	// kept up to date tile by tile by set_cell
+	cluster_graph clusters;
+	// Set to answer queries to the end node from a distance field over the
+	// grid (see distance_field): one breadth first search from the end on
+	// the first query, after which every query from any start follows the
+	// field, in time proportional to its path. With 'goal_cells' set (for
+	// example to exit_cells()), the field leads from any start to the
+	// nearest of those cells instead, and answers the queries to a cell
+	// when it is the nearest one from the start; the other queries are
+	// searched as usual. The paths are shortest paths on the grid, which
+	// is undirected.
+	// Takes precedence over every other search for the queries it answers.
+	bool goal_field;
+	std::vector<unsigned int> goal_cells;
+	// Distance field of 'goal_field', rebuilt when its targets or the maze change
+	distance_field field;
+	// Open cells of the maze, only built when 'implicit_grid' is set
+	grid_graph grid;
+	// Components of the open cells, built on the first search of the grid
+	component_index grid_components;
+	// Incremental planner of plan_path and repair_path, kept up to date by set_cell
+	dstar_lite planner;
+	// Character toggle_cell writes to block a cell ('#' by default)
+	char wall_char;
+	// The maze file, mapped into memory (shared by copies of the graph)
+	std::shared_ptr<mapped_file> maze_file;
+	// Offset of the first character of each row within the file, and the row lengths
+	std::vector<std::size_t> row_start;
+	std::vector<unsigned int> row_length;
 
 	// MEMBERS INHERITED FROM THE BASE CLASS (REMINDER)
 	// unsigned int N;
@@ -263,163 +5780,848 @@ public:
 
 
 // Maze graph algorithm function definitions
-std::list<unsigned int> maze_graph::DFS(std::stack<unsigned int> in_stack, std::list<unsigned int> path, unsigned int end_node) {
+graph_path maze_graph::run_algorithm(unsigned int start_node, unsigned int end_node) {
+	this->prepare_search();
+	std::vector<unsigned int> path = this->with_engine([&](auto& engine) {
+		return this->find_path(engine, start_node, end_node);
+	});
+	return graph_path(std::move(path), this->maze_width);
+};
+
+
+
+path_batch maze_graph::run_queries(batch_runner& runner, const std::vector<path_query>& queries) {
+	this->prepare_search();
+	return runner.run(queries, [this](search_engine& engine, const path_query& query) {
+		return this->find_path(engine, query.start_node, query.end_node);
+	});
+};
+
+
+
+void maze_graph::prepare_search() {
+	// Jump Point Search, the hierarchical search and the distance field need
+	// the grid, build it on first use if the maze was loaded into an
+	// adjacency list
+	bool on_grid = this->implicit_grid || this->algorithm == search_algorithm::JPS || this->hierarchical;
+	if ((this->algorithm == search_algorithm::JPS || this->hierarchical || this->goal_field) && this->grid.node_count() == 0 && this->maze_file) {
+		this->build_grid(std::max(1u, std::thread::hardware_concurrency()));
+	}
+
+	// Index the components of whatever is searched, so unsolvable queries
+	// return at once. The grid is undirected, so it needs no ranks.
+	if (on_grid) {
+		if (this->grid_components.node_count() != this->grid.node_count()) {
+			worker_pool pool;
+			this->grid_components.build(this->grid, false, pool);
+		}
+	}
+	else {
+		this->reachability();
+	}
+
+	// The bidirectional searches need the incoming edges. The implicit grid
+	// is undirected, so it is its own reverse graph.
+	bool bidirectional = this->algorithm == search_algorithm::BIDIRECTIONAL_BFS || this->algorithm == search_algorithm::BIDIRECTIONAL_DIJKSTRA;
+	if (bidirectional && !this->implicit_grid) {
+		this->in_edges();
+	}
 
-	// Stores current node
-	unsigned int curr_node = 0;
+	// Build the tiles, or rebuild the ones changed since the last search
+	if (this->hierarchical && this->grid.node_count() != 0) {
+		if (this->clusters.tile_size() != std::max(1u, this->tile_size)) {
+			worker_pool pool;
+			this->clusters.build(this->grid, this->tile_size, pool);
+		}
+		else {
+			this->clusters.refresh(this->grid);
+		}
+	}
+
+	// Search from the targets, unless the field already has them
+	if (this->goal_field && this->grid.node_count() != 0) {
+		std::vector<unsigned int> targets = this->goal_cells;
+		if (targets.empty()) {
+			targets.push_back(this->end_node);
+		}
+		std::sort(targets.begin(), targets.end());
+		targets.erase(std::unique(targets.begin(), targets.end()), targets.end());
+		if (this->field.node_count() != this->grid.node_count() || this->field.targets() != targets) {
+			this->field.build(this->grid, targets);
+		}
+	}
 
-	// Check if the stack is empty (occurrs when we reach the end of a path without finding the end node)
-	if (in_stack.empty()) {
-		return *(new std::list<unsigned int>);
+	// Contract the corridors, keeping the start and the end as junctions
+	if (this->contract_corridors && this->corridors.node_count() == 0 && this->maze_file) {
+		std::vector<unsigned int> terminals = { this->start_node, this->end_node };
+		this->corridors.build(this->N, [this](unsigned int node, unsigned int* neighbors) { return this->open_cells(node, neighbors); }, terminals);
+	}
+};
+
+
+
+template <class E>
+std::vector<unsigned int> maze_graph::find_path(E& engine, unsigned int start_node, unsigned int end_node) const {
+	// Queries to a target of the distance field follow it, without
+	// searching. With several targets the field leads to the nearest one,
+	// so its path only answers the query if that is 'end_node'.
+	if (this->goal_field && this->field.is_target(end_node)) {
+		std::vector<unsigned int> path = this->field.path(this->grid, start_node);
+		if (this->field.targets().size() == 1 || (!path.empty() && path.back() == end_node)) {
+			return path;
+		}
 	}
 
-	// Add top stack element to path
-	path.push_back(in_stack.top());
+	bool on_grid = this->implicit_grid || this->algorithm == search_algorithm::JPS || this->hierarchical;
 
-	// Check to see if we have reached the end node
-	if (in_stack.top() == end_node) {
+	// The adjacency list may be frozen in a locality order (see
+	// vertex_order), and its component index, incoming edges and views
+	// then use the new ids. The grid, the junction graph and the tiles
+	// always number the nodes by cell.
+	vertex_order cells;
+	const vertex_order& ids = on_grid ? cells : this->order;
+	unsigned int from = ids.new_id(start_node);
+	unsigned int to = ids.new_id(end_node);
+	auto original = [&](std::vector<unsigned int> path) {
+		ids.original_ids(path);
 		return path;
+	};
+	if (!(on_grid ? this->grid_components : this->components).may_reach(from, to)) {
+		return std::vector<unsigned int>();
 	}
 
-	// Remove top stack element
-	curr_node = in_stack.top();
-	in_stack.pop();
+	if (this->hierarchical) {
+		return this->clusters.find_path(engine, this->grid, start_node, end_node);
+	}
+
+	// The junction graph is searched whenever both ends are junctions (the
+	// start and end nodes always are), and the path expanded back to cells
+	unsigned int start_junction = this->contract_corridors ? this->corridors.junction(start_node) : NO_NODE;
+	unsigned int end_junction = this->contract_corridors ? this->corridors.junction(end_node) : NO_NODE;
+	if (start_junction != NO_NODE && end_junction != NO_NODE) {
+		std::vector<unsigned int> junctions;
+		if (this->algorithm == search_algorithm::DFS) {
+			junctions = engine.DFS(this->corridors, start_junction, end_junction);
+		}
+		else if (this->algorithm == search_algorithm::BIDIRECTIONAL_BFS || this->algorithm == search_algorithm::BIDIRECTIONAL_DIJKSTRA) {
+			junctions = engine.bidirectional_Dijkstra(this->corridors, this->corridors, start_junction, end_junction, meta_weight<edge_weight<unsigned int>>());
+		}
+		else {
+			junctions = engine.Dijkstra(this->corridors, start_junction, end_junction, meta_weight<edge_weight<unsigned int>>());
+		}
+		return this->corridors.expand(junctions, [this](unsigned int node, unsigned int* neighbors) { return this->open_cells(node, neighbors); });
+	}
+
+	if (this->algorithm == search_algorithm::JPS) {
+		return engine.JPS(this->grid, start_node, end_node);
+	}
 
-	int run = 1;
-	// Add nodes connected to the node we just removed
-	// If we have more than one path, create a new stack for each path so that we can try all of them
-	for (unsigned int i = 0; i < this->adj_list[curr_node].size(); i++) {
-		// Check to see if we have already seen the node we are about to add
-		run = 1;
-		for (std::list<unsigned int>::iterator k = path.begin(); k != path.end(); ++k) {
-			if (*k == this->adj_list[curr_node][i].destination) {
-				run = 0;
+	if (this->algorithm == search_algorithm::BIDIRECTIONAL_BFS || this->algorithm == search_algorithm::BIDIRECTIONAL_DIJKSTRA) {
+		bool dijkstra = this->algorithm == search_algorithm::BIDIRECTIONAL_DIJKSTRA;
+		if (this->implicit_grid) {
+			if (dijkstra) {
+				return engine.bidirectional_Dijkstra(this->grid, this->grid, start_node, end_node, unit_weight());
 			}
+			return engine.bidirectional_BFS(this->grid, this->grid, start_node, end_node);
 		}
-		if (run == 1) {
-			// If we have not already visited this node:
-			in_stack.push(this->adj_list[curr_node][i].destination);
-			std::list<unsigned int> path_temp = DFS(in_stack, path, end_node);
+		return original(this->visit_view([&](const auto& view) {
+			if (dijkstra) {
+				return engine.bidirectional_Dijkstra(view, this->reverse, from, to, meta_weight<edge_weight<T_MetaData>>());
+			}
+			return engine.bidirectional_BFS(view, this->reverse, from, to);
+		}));
+	}
 
-			// If this resursive call found the end node, return this path!
-			if (!path_temp.empty()) {
-				return path_temp;
+	// Dijkstra weighs the edges of the adjacency list by their int_data
+	// (1 for every edge built by load_graph); the implicit grid has unit weights
+	if (this->algorithm == search_algorithm::DIJKSTRA) {
+		if (this->implicit_grid) {
+			return engine.Dijkstra(this->grid, start_node, end_node, unit_weight());
+		}
+		return original(this->visit_view([&](const auto& view) {
+			return engine.Dijkstra(view, from, to, meta_weight<edge_weight<T_MetaData>>());
+		}));
+	}
+
+	// BFS and A* return a shortest path, DFS returns the first path it finds.
+	// The A* heuristic decodes the cell of a node from its original id.
+	auto search = [&](const auto& view) {
+		if (this->algorithm == search_algorithm::BFS) {
+			return engine.BFS(view, from, to);
+		}
+		if (this->algorithm == search_algorithm::A_STAR) {
+			manhattan_distance distance(this->maze_width, end_node);
+			if (ids.empty()) {
+				return engine.A_star(view, from, to, distance);
 			}
+			return engine.A_star(view, from, to, [&](unsigned int node) { return distance(ids.old_id(node)); });
 		}
+		return engine.DFS(view, from, to);
+	};
+
+	// An implicit grid is searched directly, without an adjacency list
+	if (this->implicit_grid) {
+		return search(this->grid);
 	}
+	return original(this->visit_view(search));
+};
 
-	// If no path is return yet (the maze is unsolvable):
-	return *(new std::list<unsigned int>);
+
+
+void maze_graph::load_graph() {
+	this->load_graph("maze.txt", true);
 };
 
 
 
-std::list<unsigned int> maze_graph::run_algorithm(unsigned int start_node, unsigned int end_node) {
-	// CREATE STACK
-	std::stack<unsigned int> start_stack;
-	start_stack.push(start_node);
+bool maze_graph::load_graph(const std::string& path, bool echo, unsigned int threads) {
+	std::chrono::steady_clock::time_point read_start = std::chrono::steady_clock::now();
 
-	// CREATE LIST OF VISITED NODES ("PATH")
-	std::list<unsigned int> path;
+	// Open (memory-map) the input file, and only replace the current maze
+	// once it is open
+	std::shared_ptr<mapped_file> file = std::make_shared<mapped_file>();
+	if (!file->open(path)) {
+		std::cerr << "Unable to open maze file " << path << std::endl;
+		return false;
+	}
+	this->maze_file = file;
+	const char* data = this->maze_file->data();
+	std::size_t size = this->maze_file->size();
 
-	// CALL DFS FUNCTION
-	return DFS(start_stack, path, end_node);
-};
+	if (threads == 0) {
+		threads = std::max(1u, std::thread::hardware_concurrency());
+	}
 
+	// Find the newlines, each thread scanning its own slice of the file
+	std::vector<std::vector<std::size_t>> newlines(threads);
+	std::vector<std::thread> workers;
+	for (unsigned int t = 0; t < threads && size > 0; t++) {
+		workers.push_back(std::thread([&, t]() {
+			std::size_t begin = size / threads * t;
+			std::size_t end = (t == threads - 1) ? size : size / threads * (t + 1);
+			const char* pos = data + begin;
+			while ((pos = (const char*)memchr(pos, '\n', data + end - pos)) != nullptr) {
+				newlines[t].push_back(pos - data);
+				pos++;
+			}
+		}));
+	}
+	for (unsigned int t = 0; t < workers.size(); t++) {
+		workers[t].join();
+	}
+	workers.clear();
 
+	// Turn the newlines into rows (a trailing newline does not start a new row)
+	this->row_start.clear();
+	this->row_length.clear();
+	std::size_t begin = 0;
+	for (unsigned int t = 0; t < threads; t++) {
+		for (unsigned int k = 0; k < newlines[t].size(); k++) {
+			this->row_start.push_back(begin);
+			this->row_length.push_back((unsigned int)(newlines[t][k] - begin));
+			begin = newlines[t][k] + 1;
+		}
+	}
+	if (begin < size) {
+		this->row_start.push_back(begin);
+		this->row_length.push_back((unsigned int)(size - begin));
+	}
+	this->maze_height = (unsigned int)this->row_start.size();
+	this->maze_width = 0;
+	for (unsigned int i = 0; i < this->maze_height; i++) {
+		this->maze_width = std::max(this->maze_width, this->row_length[i]);
+	}
+	std::chrono::steady_clock::time_point read_end = std::chrono::steady_clock::now();
 
-void maze_graph::load_graph() {
-	int count = 0;
-	// Open input file
-	std::ifstream maze_file("maze.txt");
+	// Print the maze (the rows are already laid out in the file)
+	if (echo && this->maze_height > 0) {
+		std::cout << "Rows: " << this->maze_height << " Columns: " << this->row_length[0] << std::endl;
+		std::cout.write(data, size);
+		if (data[size - 1] != '\n') {
+			std::cout << std::endl;
+		}
+	}
 
-	// Temp variables used to store file data
-	char char_temp;
-	std::vector<char> vec_temp;
+	// Every cell of the maze is a node
+	this->thaw();
+	this->reverse_valid = false;
+	this->components_valid = false;
+	this->release_edges();
+	this->N = this->maze_width * this->maze_height;
+	this->start_node = NO_NODE;
+	this->end_node = NO_NODE;
+	this->planner = dstar_lite();
+	this->corridors.clear();
+	this->clusters.clear();
+	this->field.clear();
+	std::chrono::steady_clock::time_point build_start = std::chrono::steady_clock::now();
+	if (this->implicit_grid) {
+		this->build_grid(threads);
+	}
+	else {
+		this->grid = grid_graph();
+		this->build_edges(threads);
+	}
 
-	// Fill maze vector with file data
-	while (maze_file.get(char_temp)) {
-		// Store maze in the array
-		if (char_temp != '\n') {
-			vec_temp.push_back(char_temp);
-			count++;
+	// Record the loading phases and the memory the graph takes
+	if (this->stats != nullptr) {
+		this->stats->seconds[(int)search_phase::FILE_READ] += std::chrono::duration<double>(read_end - read_start).count();
+		this->stats->seconds[(int)search_phase::EDGE_BUILD] += std::chrono::duration<double>(std::chrono::steady_clock::now() - build_start).count();
+		std::size_t bytes = this->row_start.capacity() * sizeof(std::size_t) + this->row_length.capacity() * sizeof(unsigned int);
+		bytes += this->grid.cells.capacity() * sizeof(unsigned long long) + this->adj_list.capacity() * sizeof(std::pmr::vector<adjacency_entry<T_MetaData>>);
+		for (unsigned int i = 0; i < this->adj_list.size(); i++) {
+			bytes += this->adj_list[i].capacity() * sizeof(adjacency_entry<T_MetaData>);
 		}
-		else {
-			this->maze.push_back(vec_temp);
-			vec_temp.resize(0);
-			this->maze_width = count;
-			count = 0;
+		this->stats->bytes_allocated += bytes;
+	}
+	return true;
+};
+
+
+
+bool maze_graph::save_snapshot(const std::string& path) const {
+	if (!this->maze_file) {
+		std::cerr << "No maze is loaded" << std::endl;
+		return false;
+	}
+
+	// Only the metadata load_graph builds can be restored
+	bool plain = this->visit_view([](const auto& view) {
+		for (unsigned int i = 0; i < view.node_count(); i++) {
+			for (unsigned int j = 0; j < view.degree(i); j++) {
+				if (view.meta(i, j).int_data != 1 || !view.meta(i, j).string_data.empty()) {
+					return false;
+				}
+			}
 		}
+		return true;
+	});
+	if (!plain) {
+		std::cerr << "Unable to save a maze with custom edge metadata to a snapshot" << std::endl;
+		return false;
+	}
+
+	snapshot_writer out;
+	if (!out.open(path)) {
+		return false;
+	}
+	this->write_snapshot(out);
+	out.header.flags = SNAPSHOT_MAZE | (this->implicit_grid ? SNAPSHOT_IMPLICIT_GRID : 0);
+	out.header.maze_width = this->maze_width;
+	out.header.maze_height = this->maze_height;
+	out.header.start_node = this->start_node;
+	out.header.end_node = this->end_node;
+	out.header.search_char = this->search_char;
+	out.header.end_char = this->end_char;
+	out.header.start_char = this->start_char;
+
+	// The rows, as they are laid out in the maze file, and where each row starts within them
+	std::size_t first = this->maze_height == 0 ? 0 : this->row_start[0];
+	std::size_t last = this->maze_height == 0 ? 0 : this->row_start[this->maze_height - 1] + this->row_length[this->maze_height - 1];
+	std::vector<std::size_t> starts(this->maze_height);
+	for (unsigned int i = 0; i < this->maze_height; i++) {
+		starts[i] = this->row_start[i] - first;
+	}
+	out.begin(snapshot_section::MAZE_TEXT);
+	out.write(this->maze_file->data() + first, last - first);
+	out.begin(snapshot_section::ROW_START);
+	out.write(starts.data(), starts.size() * sizeof(std::size_t));
+	out.begin(snapshot_section::ROW_LENGTH);
+	out.write(this->row_length.data(), this->row_length.size() * sizeof(unsigned int));
+	return out.finish();
+};
+
+
+
+bool maze_graph::load_snapshot(const std::string& path, unsigned int threads) {
+	std::shared_ptr<mapped_file> file = std::make_shared<mapped_file>();
+	if (!file->open(path, false)) {
+		std::cerr << "Unable to open snapshot file " << path << std::endl;
+		return false;
+	}
+	const snapshot_header* header = check_snapshot(*file, 0, alignof(T_MetaData), path);
+	if (header == nullptr) {
+		return false;
+	}
+	const std::uint64_t* size = header->section_size;
+	std::uint64_t cells = (std::uint64_t)header->maze_width * header->maze_height;
+	if (!(header->flags & SNAPSHOT_MAZE) || size[(int)snapshot_section::ROW_START] != header->maze_height * sizeof(std::size_t) || size[(int)snapshot_section::ROW_LENGTH] != header->maze_height * sizeof(unsigned int) || cells > NO_NODE) {
+		std::cerr << "The file " << path << " is not a maze snapshot" << std::endl;
+		return false;
+	}
+
+	// The graph edges are used in place, each with the metadata load_graph gives them
+	T_MetaData fill = T_MetaData();
+	fill.int_data = 1;
+	this->map_snapshot(file, *header, fill);
+
+	this->maze_width = header->maze_width;
+	this->maze_height = header->maze_height;
+	this->N = (unsigned int)cells;
+	this->start_node = header->start_node;
+	this->end_node = header->end_node;
+	this->search_char = header->search_char;
+	this->end_char = header->end_char;
+	this->start_char = header->start_char;
+
+	// The rows only take one entry per row, so they are copied, pointing into the stored text
+	const char* base = file->data();
+	const std::size_t* starts = (const std::size_t*)(base + header->section_at[(int)snapshot_section::ROW_START]);
+	const unsigned int* lengths = (const unsigned int*)(base + header->section_at[(int)snapshot_section::ROW_LENGTH]);
+	this->row_start.resize(this->maze_height);
+	this->row_length.assign(lengths, lengths + this->maze_height);
+	for (unsigned int i = 0; i < this->maze_height; i++) {
+		this->row_start[i] = header->section_at[(int)snapshot_section::MAZE_TEXT] + starts[i];
 	}
-	// Add final vector
-	this->maze.push_back(vec_temp);
+	this->maze_file = file;
 
-	// DEBUG: PRINT MAZE
-	std::cout << "Rows: " << this->maze.size() << " Columns: " << this->maze[0].size() << std::endl;
-	for (int i = 0; i < this->maze.size(); i++) {
-		for (int j = 0; j < this->maze[i].size(); j++) {
-			std::cout << this->maze[i][j];
+	// An implicit grid is rebuilt from the text, one bit per cell
+	this->implicit_grid = (header->flags & SNAPSHOT_IMPLICIT_GRID) != 0;
+	this->grid = grid_graph();
+	this->grid_components = component_index();
+	this->planner = dstar_lite();
+	this->corridors.clear();
+	this->clusters.clear();
+	this->field.clear();
+	if (this->implicit_grid) {
+		this->build_grid(threads == 0 ? std::max(1u, std::thread::hardware_concurrency()) : threads);
+	}
+	return true;
+};
+
+
+
+unsigned int maze_graph::cell_edges(unsigned int row, unsigned int col, unsigned int* neighbors) const {
+	char char_temp = this->cell(row, col);
+	if (char_temp != this->search_char && char_temp != this->start_char) {
+		return 0;
+	}
+
+	// Check to see if any of the surrounding nodes are also path characters
+	// (in the order left, right, up, down)
+	unsigned int node = this->maze_width * row + col;
+	unsigned int count = 0;
+	char left = (col > 0) ? this->cell(row, col - 1) : '\0';
+	char right = this->cell(row, col + 1);
+	char up = (row > 0) ? this->cell(row - 1, col) : '\0';
+	char down = this->cell(row + 1, col);
+	if (left != '\0' && (left == this->search_char || left == this->end_char)) {
+		neighbors[count++] = node - 1;
+	}
+	if (right != '\0' && (right == this->search_char || right == this->end_char)) {
+		neighbors[count++] = node + 1;
+	}
+	if (up != '\0' && (up == this->search_char || up == this->end_char)) {
+		neighbors[count++] = node - this->maze_width;
+	}
+	if (down != '\0' && (down == this->search_char || down == this->end_char)) {
+		neighbors[count++] = node + this->maze_width;
+	}
+	return count;
+};
+
+
+
+std::vector<unsigned int> maze_graph::exit_cells() const {
+	std::vector<unsigned int> exits;
+	if (!this->maze_file) {
+		return exits;
+	}
+	for (unsigned int row = 0; row < this->maze_height; row++) {
+		const char* text = this->maze_file->data() + this->row_start[row];
+		const char* last = text + this->row_length[row];
+		for (const char* at = text; (at = (const char*)std::memchr(at, this->end_char, last - at)) != nullptr; at++) {
+			exits.push_back(this->maze_width * row + (unsigned int)(at - text));
 		}
-		std::cout << std::endl;
 	}
-	
-	// Add edges to adjacency list
-	for (unsigned int i = 0; i < this->maze.size(); i++) {
-		for (unsigned int j = 0; j < this->maze[i].size(); j++) {
-			char_temp = this->maze[i][j];
+	return exits;
+};
+
+
+
+unsigned int maze_graph::open_cells(unsigned int node, unsigned int* neighbors) const {
+	unsigned int row = node / this->maze_width;
+	unsigned int col = node % this->maze_width;
+	auto open = [this](char c) { return c != '\0' && (c == this->search_char || c == this->start_char || c == this->end_char); };
+	if (!open(this->cell(row, col))) {
+		return 0;
+	}
+
+	unsigned int count = 0;
+	if (col > 0 && open(this->cell(row, col - 1))) {
+		neighbors[count++] = node - 1;
+	}
+	if (open(this->cell(row, col + 1))) {
+		neighbors[count++] = node + 1;
+	}
+	if (row > 0 && open(this->cell(row - 1, col))) {
+		neighbors[count++] = node - this->maze_width;
+	}
+	if (open(this->cell(row + 1, col))) {
+		neighbors[count++] = node + this->maze_width;
+	}
+	return count;
+};
+
+
+
+bool maze_graph::set_cell(unsigned int row, unsigned int col, char c) {
+	if (!this->maze_file || row >= this->maze_height || col >= this->row_length[row]) {
+		return false;
+	}
+	unsigned int node = this->maze_width * row + col;
 
-			if (char_temp == this->start_char) {
-				// Add the starting node to the adjacency list (also assume that the node underneath it is connected)
-				this->start_node = this->maze_width * i + j;
-				this->add_edge(this->start_node, this->maze_width * (i + 1) + j);
+	// The adjacency list is edited in place, so a frozen graph is thawed first
+	if (!this->implicit_grid) {
+		this->thaw();
+	}
+
+	// Write the character into the maze text, copying it first if copies of the graph share it
+	if (this->maze_file.use_count() > 1) {
+		std::shared_ptr<mapped_file> copy = std::make_shared<mapped_file>();
+		copy->assign(this->maze_file->data(), this->maze_file->size());
+		this->maze_file = copy;
+	}
+	char* text = this->maze_file->writable_data();
+	if (text == nullptr) {
+		std::cerr << "Unable to modify the maze" << std::endl;
+		return false;
+	}
+	text[this->row_start[row] + col] = c;
+	this->corridors.clear();
+	this->field.clear();
+	if (c == this->start_char) {
+		this->start_node = node;
+	}
+	else if (node == this->start_node) {
+		this->start_node = NO_NODE;
+	}
+	if (c == this->end_char) {
+		this->end_node = node;
+	}
+	else if (node == this->end_node) {
+		this->end_node = NO_NODE;
+	}
+
+	// The cell and its neighbors, whose edges may have changed
+	unsigned int cells[5];
+	unsigned int count = 0;
+	cells[count++] = node;
+	if (col > 0) cells[count++] = node - 1;
+	if (col + 1 < this->maze_width) cells[count++] = node + 1;
+	if (row > 0) cells[count++] = node - this->maze_width;
+	if (row + 1 < this->maze_height) cells[count++] = node + this->maze_width;
+
+	// The grid, if it was built, and the planner searching it. Opening a
+	// cell joins the components around it; blocking one keeps the index
+	// valid (see Graph<T>::remove_node).
+	bool open = c == this->search_char || c == this->start_char || c == this->end_char;
+	if (this->grid.node_count() != 0) {
+		this->grid.set_open(node, open);
+		this->clusters.invalidate(node);
+		if (open && this->grid_components.node_count() == this->grid.node_count()) {
+			for (unsigned int k = 1; k < count; k++) {
+				if (this->grid.is_open(cells[k])) {
+					this->grid_components.add_edge(node, cells[k]);
+				}
 			}
-			else if (char_temp == this->end_char) {
-				this->end_node = this->maze_width * i + j;
+		}
+		if (this->planner.planned()) {
+			for (unsigned int k = 0; k < count; k++) {
+				this->planner.update(this->grid, cells[k]);
 			}
-			else if (char_temp == this->search_char || char_temp == this->start_char) {
-				// Check to see if any of the surrounding nodes are also path characters
-				if (this->maze[i][j - 1] == this->search_char || this->maze[i][j - 1] == this->end_char) {
-					this->add_edge(this->maze_width * i + j, this->maze_width * i + j - 1);
-				}
-				if (this->maze[i][j + 1] == this->search_char || this->maze[i][j + 1] == this->end_char) {
-					this->add_edge(this->maze_width * i + j, this->maze_width * i + j + 1);
-				}
-				if (this->maze[i-1][j] == this->search_char || this->maze[i - 1][j] == end_char) {
-					this->add_edge(this->maze_width * i + j, this->maze_width * (i-1) + j);
-				}
-				if (this->maze[i + 1][j] == this->search_char || this->maze[i + 1][j] == this->end_char) {
-					this->add_edge(this->maze_width * i + j, this->maze_width * (i + 1) + j);
+		}
+	}
+
+	// The adjacency list: rebuild the edges of the cell and its neighbors,
+	// exactly as load_graph builds them
+	if (!this->implicit_grid) {
+		for (unsigned int k = 0; k < count; k++) {
+			unsigned int neighbors[4];
+			unsigned int edge_count = this->cell_edges(cells[k] / this->maze_width, cells[k] % this->maze_width, neighbors);
+			std::pmr::vector<adjacency_entry<T_MetaData>>& edges = this->adj_list[cells[k]];
+			edges.resize(edge_count);
+			for (unsigned int e = 0; e < edge_count; e++) {
+				edges[e].destination = neighbors[e];
+				edges[e].meta_data.int_data = 1;
+				edges[e].meta_data.string_data.clear();
+				if (this->components_valid) {
+					this->components.add_edge(cells[k], neighbors[e]);
 				}
 			}
 		}
+		this->reverse_valid = false;
+	}
+	return true;
+};
+
+
+
+bool maze_graph::toggle_cell(unsigned int row, unsigned int col) {
+	char c = this->cell(row, col);
+	if (c == '\0' || c == this->start_char || c == this->end_char) {
+		return false;
+	}
+	return this->set_cell(row, col, c == this->search_char ? this->wall_char : this->search_char);
+};
+
 
+
+graph_path maze_graph::plan_path(unsigned int start_node, unsigned int end_node) {
+	if (this->grid.node_count() == 0 && this->maze_file) {
+		this->build_grid(std::max(1u, std::thread::hardware_concurrency()));
 	}
+	return this->planner.plan(this->grid, start_node, end_node, this->maze_width);
 };
 
 
 
-void maze_graph::print_maze(std::list<unsigned int> in_list) {
-	int solution = 0;
-	for (unsigned int i = 0; i < this->maze.size(); i++) {
-		for (unsigned int j = 0; j < this->maze[i].size(); j++) {
-			// Check to see if this is a coordinate that is part of the solution
-			solution = 0;
-			for (std::list<unsigned int>::iterator k = in_list.begin(); k != in_list.end(); ++k) {
-				if (*k == (i * this->maze_width + j) && (i * this->maze_width + j) != this->start_node && (i * this->maze_width + j) != this->end_node) {
-					solution = 1;
+void maze_graph::build_edges(unsigned int threads) {
+	const char* data = this->maze_file->data();
+	std::vector<std::thread> workers;
+	this->adj_list.resize(this->N);
+
+	// Add edges to the adjacency list, each thread handling a band of rows.
+	// A thread only writes the edge vectors of its own rows' cells. The rows
+	// are compared with the maze characters a vector at a time, and the
+	// edges are read from shifted masks (the same edges as cell_edges). Memory
+	// resources other than the heap are not thread-safe in general (an
+	// arena is not), so with one the edges are built on one thread.
+	if (this->memory_resource() != std::pmr::new_delete_resource()) {
+		threads = 1;
+	}
+	threads = std::max(1u, std::min(threads, this->maze_height));
+	std::vector<unsigned int> band_start(threads, NO_NODE);
+	std::vector<unsigned int> band_end(threads, NO_NODE);
+	for (unsigned int t = 0; t < threads; t++) {
+		workers.push_back(std::thread([&, t]() {
+			unsigned int first_row = (unsigned int)((unsigned long long)this->maze_height * t / threads);
+			unsigned int last_row = (unsigned int)((unsigned long long)this->maze_height * (t + 1) / threads);
+			unsigned int neighbors[4];
+			unsigned int count;
+
+			// Row masks (see match_row), with one more, empty word so the
+			// right neighbors of the last word can be read: the cells edges
+			// lead to (path and end cells) in the rows above, here and
+			// below, and the cells of this row edges leave from (path and
+			// start cells), the start cells and the end cells
+			std::size_t words = (this->maze_width + 63) / 64 + 1;
+			std::vector<unsigned long long> above(words), here(words), below(words);
+			std::vector<unsigned long long> sources(words), starts(words), ends(words);
+			auto scan = [&](unsigned int row, char a, char b, std::vector<unsigned long long>& mask) {
+				std::fill(mask.begin(), mask.end(), 0);
+				if (row < this->maze_height) {
+					match_row(data + this->row_start[row], this->row_length[row], a, b, mask.data());
+				}
+			};
+			scan(first_row - 1, this->search_char, this->end_char, above);
+			scan(first_row, this->search_char, this->end_char, here);
+
+			for (unsigned int i = first_row; i < last_row; i++) {
+				scan(i + 1, this->search_char, this->end_char, below);
+				scan(i, this->search_char, this->start_char, sources);
+				scan(i, this->start_char, this->start_char, starts);
+				scan(i, this->end_char, this->end_char, ends);
+
+				for (std::size_t w = 0; w + 1 < words; w++) {
+					unsigned int base = this->maze_width * i + (unsigned int)(w * 64);
+
+					// End cells have no edges of their own
+					for (unsigned long long bits = ends[w]; bits != 0; bits &= bits - 1) {
+						band_end[t] = base + lowest_bit(bits);
+					}
+					for (unsigned long long bits = starts[w] & ~ends[w]; bits != 0; bits &= bits - 1) {
+						band_start[t] = base + lowest_bit(bits);
+					}
+
+					// Edge masks of 64 cells at once: a cell has an edge to
+					// the left if the cell before it is a target, and so on
+					unsigned long long left = (here[w] << 1) | (w > 0 ? here[w - 1] >> 63 : 0);
+					unsigned long long right = (here[w] >> 1) | (here[w + 1] << 63);
+					unsigned long long up = above[w];
+					unsigned long long down = below[w];
+
+					for (unsigned long long bits = sources[w] & ~ends[w]; bits != 0; bits &= bits - 1) {
+						unsigned int b = lowest_bit(bits);
+						unsigned int node = base + b;
+						count = 0;
+						if ((left >> b) & 1) neighbors[count++] = node - 1;
+						if ((right >> b) & 1) neighbors[count++] = node + 1;
+						if ((up >> b) & 1) neighbors[count++] = node - this->maze_width;
+						if ((down >> b) & 1) neighbors[count++] = node + this->maze_width;
+
+						std::pmr::vector<adjacency_entry<T_MetaData>>& edges = this->adj_list[node];
+						edges.resize(count);
+						for (unsigned int k = 0; k < count; k++) {
+							edges[k].destination = neighbors[k];
+							// Every step through the maze costs 1
+							edges[k].meta_data.int_data = 1;
+						}
+					}
 				}
+				above.swap(here);
+				here.swap(below);
+			}
+		}));
+	}
+	for (unsigned int t = 0; t < threads; t++) {
+		workers[t].join();
+	}
+
+	// If the maze has several start or end characters, the last one wins
+	for (unsigned int t = 0; t < threads; t++) {
+		if (band_start[t] != NO_NODE) {
+			this->start_node = band_start[t];
+		}
+		if (band_end[t] != NO_NODE) {
+			this->end_node = band_end[t];
+		}
+	}
+};
+
+
+
+void maze_graph::build_grid(unsigned int threads) {
+	const char* data = this->maze_file->data();
+	std::vector<std::thread> workers;
+	this->grid.resize(this->maze_width, this->maze_height);
+	this->grid_components = component_index();
+
+	// Each thread fills its own range of bitmap words, so no two threads
+	// ever write the same word
+	std::size_t words = this->grid.cells.size();
+	if (words == 0) {
+		return;
+	}
+	threads = (unsigned int)std::max((std::size_t)1, std::min((std::size_t)threads, words));
+	std::vector<unsigned int> band_start(threads, NO_NODE);
+	std::vector<unsigned int> band_end(threads, NO_NODE);
+	for (unsigned int t = 0; t < threads; t++) {
+		workers.push_back(std::thread([&, t]() {
+			std::size_t first_word = words * t / threads;
+			std::size_t last_word = words * (t + 1) / threads;
+			unsigned long long first_node = first_word * 64;
+			unsigned long long last_node = std::min((unsigned long long)last_word * 64, (unsigned long long)this->N);
+			if (first_node >= last_node) {
+				return;
 			}
-			// If the coordinate is part of the solution, print a "+"
-			if (solution == 1) {
-				std::cout << "+";
+
+			// Scan every row the thread's words overlap (see match_row) into
+			// masks of its open, start and end cells, then shift the open
+			// cells into the bitmap, writing only the thread's own words
+			std::size_t row_words = (this->maze_width + 63) / 64;
+			std::vector<unsigned long long> open(row_words), starts(row_words), ends(row_words);
+			auto scan = [&](unsigned int row, char a, char b, std::vector<unsigned long long>& mask) {
+				std::fill(mask.begin(), mask.end(), 0);
+				match_row(data + this->row_start[row], this->row_length[row], a, b, mask.data());
+			};
+			unsigned int last_row = (unsigned int)((last_node - 1) / this->maze_width);
+			for (unsigned int i = (unsigned int)(first_node / this->maze_width); i <= last_row; i++) {
+				scan(i, this->search_char, this->start_char, open);
+				match_row(data + this->row_start[i], this->row_length[i], this->end_char, this->end_char, open.data());
+				scan(i, this->start_char, this->start_char, starts);
+				scan(i, this->end_char, this->end_char, ends);
+
+				for (std::size_t w = 0; w < row_words; w++) {
+					unsigned long long base = (unsigned long long)i * this->maze_width + w * 64;
+					std::size_t word = base / 64;
+					unsigned int shift = base % 64;
+					if (word >= first_word && word < last_word) {
+						this->grid.cells[word] |= open[w] << shift;
+					}
+					if (shift != 0 && word + 1 >= first_word && word + 1 < last_word) {
+						this->grid.cells[word + 1] |= open[w] >> (64 - shift);
+					}
+
+					for (unsigned long long bits = starts[w]; bits != 0; bits &= bits - 1) {
+						unsigned long long node = base + lowest_bit(bits);
+						if (node >= first_node && node < last_node) {
+							band_start[t] = (unsigned int)node;
+						}
+					}
+					for (unsigned long long bits = ends[w] & ~starts[w]; bits != 0; bits &= bits - 1) {
+						unsigned long long node = base + lowest_bit(bits);
+						if (node >= first_node && node < last_node) {
+							band_end[t] = (unsigned int)node;
+						}
+					}
+				}
 			}
-			else {
-				std::cout << this->maze[i][j];
+		}));
+	}
+	for (unsigned int t = 0; t < threads; t++) {
+		workers[t].join();
+	}
+
+	// If the maze has several start or end characters, the last one wins
+	for (unsigned int t = 0; t < threads; t++) {
+		if (band_start[t] != NO_NODE) {
+			this->start_node = band_start[t];
+		}
+		if (band_end[t] != NO_NODE) {
+			this->end_node = band_end[t];
+		}
+	}
+};
+
+
+
+void maze_graph::print_maze(const graph_path& path) const {
+	this->render_maze(path, std::cout);
+}
+
+
+
+void maze_graph::render_maze(const graph_path& path, std::ostream& out) const {
+	// Size of the output buffer, written whenever it fills up
+	const std::size_t BLOCK = 1 << 20;
+
+	// Mark every cell of the path (except the start and the end) in a bitmap
+	unsigned long long cells = (unsigned long long)this->maze_width * this->maze_height;
+	std::vector<unsigned long long> marks((cells + 63) / 64, 0);
+	for (unsigned int node : path) {
+		if (node < cells && node != this->start_node && node != this->end_node) {
+			marks[node / 64] |= 1ULL << (node % 64);
+		}
+	}
+
+	// Copy the rows into the buffer, then overwrite the marked cells of each
+	// row, skipping the bitmap words with no marks
+	std::string buffer;
+	buffer.reserve(BLOCK + this->maze_width + 1);
+	for (unsigned int i = 0; i < this->maze_height; i++) {
+		std::size_t row_begin = buffer.size();
+		buffer.append(this->maze_file->data() + this->row_start[i], this->row_length[i]);
+		unsigned long long first = (unsigned long long)i * this->maze_width;
+		unsigned long long last = first + this->row_length[i];
+		for (unsigned long long w = first / 64; w * 64 < last; w++) {
+			for (unsigned long long bits = marks[w]; bits != 0; bits &= bits - 1) {
+				unsigned long long node = w * 64 + lowest_bit(bits);
+				if (node >= first && node < last) {
+					buffer[row_begin + (node - first)] = '+';
+				}
 			}
 		}
-		// After each line, print a newline
-		std::cout << std::endl;
+		buffer += '\n';
+		if (buffer.size() >= BLOCK) {
+			out.write(buffer.data(), buffer.size());
+			buffer.clear();
+		}
+	}
+	out.write(buffer.data(), buffer.size());
+	out.flush();
+}
+
+
+
+bool maze_graph::save_maze(const graph_path& path, const std::string& file_path) const {
+	std::ofstream file(file_path, std::ios::binary);
+	if (!file) {
+		std::cerr << "Unable to open output file " << file_path << std::endl;
+		return false;
 	}
+	this->render_maze(path, file);
+	return (bool)file;
 }
 
 #endif
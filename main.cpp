@@ -65,12 +65,12 @@ int main(int argc, char** argv) {
 
 	// Run algorithm
 	std::cout << "Running a search algorithm on the graph storing integer metadata. Starting at node 2, looking for node 10. The correct sequence to follow is:" << std::endl;
-	std::list<unsigned int> my_list = test_graph->run_algorithm(2, 10);
+	graph_path my_path = test_graph->run_algorithm(2, 10);
 
 	// Print algorithm result
 	std::cout << "Start";
-	for (std::list<unsigned int>::iterator i = my_list.begin(); i != my_list.end(); ++i)
-		std::cout << "->" << *i;
+	for (std::size_t i = 0; i < my_path.size(); i++)
+		std::cout << "->" << my_path[i];
 	std::cout << std::endl;
 
 	std::cout << std::endl << "Press any key to continue." << std::endl;
@@ -80,25 +80,32 @@ int main(int argc, char** argv) {
 	std::cout << "_____________________________________________" << std::endl << std::endl;
 	std::cout << "MAZE SOLVING TEST" << std::endl;
 
-	// Scan in maze
+	// Scan in maze (from maze.txt, or from the optional fourth command line argument)
 	maze_graph* test_graph_maze = new maze_graph(**(argv + 1), **(argv + 2), **(argv + 3));
-	test_graph_maze->load_graph();
+	if (argc > 4) {
+		if (!test_graph_maze->load_graph(argv[4], true)) {
+			return -1;
+		}
+	}
+	else {
+		test_graph_maze->load_graph();
+	}
 
 	// Print graph
 	//test_graph_maze->print_graph();
 
 	// Run algorithm
 	std::cout << "Running a search algorithm on the maze. The correct sequence to follow is:" << std::endl;
-	my_list = test_graph_maze->run_algorithm(test_graph_maze->start_node, test_graph_maze->end_node);
+	my_path = test_graph_maze->run_algorithm(test_graph_maze->start_node, test_graph_maze->end_node);
 
 	// Print algorithm result
 	std::cout << "Start: ";
-	for (std::list<unsigned int>::iterator i = my_list.begin(); i != my_list.end(); ++i)
-		std::cout << "->" << *i;
+	for (std::size_t i = 0; i < my_path.size(); i++)
+		std::cout << "->" << my_path[i];
 	std::cout << std::endl;
 
 	// Print solved maze
-	test_graph_maze->print_maze(my_list);
+	test_graph_maze->print_maze(my_path);
 
 
 	std::cout << std::endl <<  "Press any key to continue." << std::endl;
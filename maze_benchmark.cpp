@@ -0,0 +1,244 @@
+#include "graph.hpp"
+#include "maze_generator.hpp"
+#include <cerrno>
+#include <chrono>
+#include <limits>
+#include <string.h>
+
+// Maze benchmark: generates a maze with maze_generator, then times each
+// phase of solving it separately: loading the maze (as an adjacency list,
+// as an adjacency list on a memory arena and as an implicit grid),
+// renumbering its cells along a Hilbert curve, contracting its corridors
+// into a junction graph, splitting it into tiles for the hierarchical
+// search, building the distance field to its end, the incoming edges,
+// the component index and the CSR snapshot, saving and memory-mapping a
+// binary snapshot, every search algorithm on every layout, and rendering
+// the solved maze. Each search is also run once more with search_stats,
+// to report the nodes it expanded, the edges it scanned and its largest
+// frontier. The timings are printed as JSON, so runs can be compared
+// between releases.
+//
+// Usage: maze_benchmark [width] [height] [perfect|rooms] [seed] [repetitions] [threads]
+
+const char* USAGE = "Usage: maze_benchmark [width] [height] [perfect|rooms] [seed] [repetitions] [threads]";
+
+
+
+// One timed phase: its name, the layout it ran on, the best time over
+// the repetitions, and the length of the path found and the work counted
+// by search_stats (for searches)
+struct timing {
+	std::string name;
+	std::string layout;
+	double seconds;
+	std::size_t path_length;
+	search_stats counters = search_stats();
+};
+
+
+
+const char* algorithm_name(search_algorithm algorithm) {
+	switch (algorithm) {
+	case search_algorithm::DFS: return "DFS";
+	case search_algorithm::BFS: return "BFS";
+	case search_algorithm::A_STAR: return "A_STAR";
+	case search_algorithm::JPS: return "JPS";
+	case search_algorithm::BIDIRECTIONAL_BFS: return "BIDIRECTIONAL_BFS";
+	case search_algorithm::BIDIRECTIONAL_DIJKSTRA: return "BIDIRECTIONAL_DIJKSTRA";
+	case search_algorithm::DIJKSTRA: return "DIJKSTRA";
+	}
+	return "UNKNOWN";
+}
+
+
+
+// Read a decimal argument of at least 'minimum' into 'value'. Returns
+// false for anything else (signs, other characters, values too large for
+// 'value').
+template <class N>
+bool parse_argument(const char* text, N minimum, N& value) {
+	if (*text < '0' || *text > '9') {
+		return false;
+	}
+	char* end = nullptr;
+	errno = 0;
+	unsigned long long parsed = strtoull(text, &end, 10);
+	if (*end != '\0' || errno == ERANGE || parsed < minimum || parsed > std::numeric_limits<N>::max()) {
+		return false;
+	}
+	value = (N)parsed;
+	return true;
+}
+
+
+
+// Time one call of 'f'
+template <class F>
+double time_once(F f) {
+	std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+	f();
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - begin;
+	return elapsed.count();
+}
+
+
+
+// Time every search algorithm on a loaded maze, keeping the best of 'reps' runs
+void time_searches(maze_graph& maze, const char* layout, unsigned int reps, std::vector<timing>& results) {
+	const search_algorithm algorithms[] = {
+		search_algorithm::DFS, search_algorithm::BFS, search_algorithm::A_STAR, search_algorithm::JPS,
+		search_algorithm::BIDIRECTIONAL_BFS, search_algorithm::BIDIRECTIONAL_DIJKSTRA, search_algorithm::DIJKSTRA
+	};
+	for (search_algorithm algorithm : algorithms) {
+		maze.algorithm = algorithm;
+		maze.prepare_search();
+		timing result = { algorithm_name(algorithm), layout, 0.0, 0 };
+		for (unsigned int r = 0; r < reps; r++) {
+			graph_path path;
+			double seconds = time_once([&]() { path = maze.run_algorithm(maze.start_node, maze.end_node); });
+			if (r == 0 || seconds < result.seconds) {
+				result.seconds = seconds;
+			}
+			result.path_length = path.size();
+		}
+
+		// Count the work in a separate run, so the timings stay uninstrumented
+		maze.instrument(&result.counters);
+		maze.run_algorithm(maze.start_node, maze.end_node);
+		maze.instrument(nullptr);
+		results.push_back(result);
+	}
+}
+
+
+
+void print_json(std::ostream& out, const char* style, unsigned int width, unsigned int height, unsigned long long seed, unsigned int threads, const std::vector<timing>& phases, const std::vector<timing>& searches) {
+	out << "{" << std::endl;
+	out << "  \"maze\": { \"style\": \"" << style << "\", \"width\": " << width << ", \"height\": " << height << ", \"seed\": " << seed << " }," << std::endl;
+	out << "  \"threads\": " << threads << "," << std::endl;
+	out << "  \"phases\": [" << std::endl;
+	for (std::size_t i = 0; i < phases.size(); i++) {
+		out << "    { \"name\": \"" << phases[i].name << "\", \"layout\": \"" << phases[i].layout << "\", \"seconds\": " << phases[i].seconds << " }";
+		out << (i + 1 < phases.size() ? "," : "") << std::endl;
+	}
+	out << "  ]," << std::endl;
+	out << "  \"searches\": [" << std::endl;
+	for (std::size_t i = 0; i < searches.size(); i++) {
+		out << "    { \"algorithm\": \"" << searches[i].name << "\", \"layout\": \"" << searches[i].layout << "\", \"seconds\": " << searches[i].seconds << ", \"path_length\": " << searches[i].path_length;
+		out << ", \"nodes_expanded\": " << searches[i].counters.nodes_expanded << ", \"edges_scanned\": " << searches[i].counters.edges_scanned;
+		out << ", \"peak_frontier\": " << searches[i].counters.peak_frontier << " }";
+		out << (i + 1 < searches.size() ? "," : "") << std::endl;
+	}
+	out << "  ]" << std::endl;
+	out << "}" << std::endl;
+}
+
+
+
+int main(int argc, char** argv) {
+	unsigned int width = 2001;
+	unsigned int height = 2001;
+	const char* style = "perfect";
+	unsigned long long seed = 1;
+	unsigned int reps = 3;
+	unsigned int threads = std::max(1u, std::thread::hardware_concurrency());
+	bool valid = argc <= 7;
+	if (argc > 1) valid = valid && parse_argument(argv[1], 3u, width);
+	if (argc > 2) valid = valid && parse_argument(argv[2], 3u, height);
+	if (argc > 3) style = argv[3];
+	if (argc > 4) valid = valid && parse_argument(argv[4], 0ull, seed);
+	if (argc > 5) valid = valid && parse_argument(argv[5], 1u, reps);
+	if (argc > 6) valid = valid && parse_argument(argv[6], 1u, threads);
+	if (!valid) {
+		std::cerr << USAGE << std::endl;
+		std::cerr << "The width and height must be at least 3, the repetitions and threads at least 1." << std::endl;
+		return -1;
+	}
+
+	if (strcmp(style, "perfect") != 0 && strcmp(style, "rooms") != 0) {
+		std::cerr << "Unknown maze style " << style << " (use perfect or rooms)" << std::endl;
+		return -1;
+	}
+	maze_style kind = strcmp(style, "rooms") == 0 ? maze_style::OPEN_ROOMS : maze_style::PERFECT;
+
+	std::vector<timing> phases;
+	std::vector<timing> searches;
+	const std::string maze_path = "benchmark_maze.txt";
+	const std::string solved_path = "benchmark_solved.txt";
+	const std::string snapshot_path = "benchmark_maze.snapshot";
+
+	// Generate the maze
+	maze_generator generator(seed);
+	bool written = false;
+	phases.push_back({ "generate", "text", time_once([&]() { written = generator.write(maze_path, width, height, kind); }), 0 });
+	if (!written) {
+		return -1;
+	}
+
+	// Adjacency list: load, build the indexes, search, then freeze and search again
+	maze_graph maze(generator.path_char, generator.end_char, generator.start_char);
+	phases.push_back({ "load_graph", "adjacency", time_once([&]() { maze.load_graph(maze_path, false, threads); }), 0 });
+	phases.push_back({ "in_edges", "adjacency", time_once([&]() { maze.in_edges(); }), 0 });
+	phases.push_back({ "reachability", "adjacency", time_once([&]() { maze.reachability(threads); }), 0 });
+	time_searches(maze, "adjacency", reps, searches);
+
+	phases.push_back({ "freeze", "csr", time_once([&]() { maze.freeze(); }), 0 });
+	time_searches(maze, "csr", reps, searches);
+
+	// Renumber the cells along a Hilbert curve, and freeze again in that order
+	vertex_order hilbert;
+	phases.push_back({ "vertex_order", "hilbert", time_once([&]() { hilbert.hilbert(maze.maze_width, maze.maze_height); }), 0 });
+	phases.push_back({ "freeze", "hilbert", time_once([&]() { maze.freeze(hilbert); }), 0 });
+	time_searches(maze, "hilbert", reps, searches);
+
+	// Adjacency list on an arena (built on one thread, see maze_graph::build_edges)
+	{
+		std::pmr::monotonic_buffer_resource arena;
+		maze_graph pooled(generator.path_char, generator.end_char, generator.start_char, &arena);
+		phases.push_back({ "load_graph", "arena", time_once([&]() { pooled.load_graph(maze_path, false, threads); }), 0 });
+	}
+
+	// Binary snapshot: save it, then map it back and search it in place
+	bool saved = false;
+	phases.push_back({ "save_snapshot", "snapshot", time_once([&]() { saved = maze.save_snapshot(snapshot_path); }), 0 });
+	if (!saved) {
+		return -1;
+	}
+	maze_graph mapped;
+	phases.push_back({ "load_snapshot", "snapshot", time_once([&]() { mapped.load_snapshot(snapshot_path, threads); }), 0 });
+	phases.push_back({ "reachability", "snapshot", time_once([&]() { mapped.reachability(threads); }), 0 });
+	time_searches(mapped, "snapshot", reps, searches);
+
+	// Render the solved maze
+	maze.algorithm = search_algorithm::BFS;
+	graph_path path = maze.run_algorithm(maze.start_node, maze.end_node);
+	phases.push_back({ "print_maze", "file", time_once([&]() { maze.save_maze(path, solved_path); }), 0 });
+
+	// Implicit grid: load and search
+	maze_graph grid(generator.path_char, generator.end_char, generator.start_char);
+	grid.implicit_grid = true;
+	phases.push_back({ "load_graph", "grid", time_once([&]() { grid.load_graph(maze_path, false, threads); }), 0 });
+	grid.algorithm = search_algorithm::BFS;
+	phases.push_back({ "reachability", "grid", time_once([&]() { grid.prepare_search(); }), 0 });
+	time_searches(grid, "grid", reps, searches);
+
+	// Junction graph: contract the corridors of the grid, then search it
+	grid.contract_corridors = true;
+	phases.push_back({ "contract_corridors", "corridors", time_once([&]() { grid.prepare_search(); }), 0 });
+	time_searches(grid, "corridors", reps, searches);
+
+	// Hierarchical search over tiles of the grid
+	grid.contract_corridors = false;
+	grid.hierarchical = true;
+	phases.push_back({ "build_tiles", "hierarchical", time_once([&]() { grid.prepare_search(); }), 0 });
+	time_searches(grid, "hierarchical", reps, searches);
+
+	// Distance field from the end: one search, then every query follows it
+	grid.hierarchical = false;
+	grid.goal_field = true;
+	phases.push_back({ "build_field", "goal_field", time_once([&]() { grid.prepare_search(); }), 0 });
+	time_searches(grid, "goal_field", reps, searches);
+
+	print_json(std::cout, style, grid.maze_width, grid.maze_height, seed, threads, phases, searches);
+	return 0;
+}
@@ -0,0 +1,193 @@
+#ifndef MAZE_GENERATOR
+#define MAZE_GENERATOR
+#include <vector>
+#include <string>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <algorithm>
+
+
+
+  /////////////////////////////////////////////////////////////////////
+ //                       MAZE GENERATOR CLASS                      //
+/////////////////////////////////////////////////////////////////////
+
+
+
+// Kinds of mazes the generator can build
+enum class maze_style { PERFECT, OPEN_ROOMS };
+
+
+
+class maze_generator {
+	// This class builds ASCII mazes of any size in the format maze_graph
+	// reads: one row per line, walls, path cells, a start cell on the top
+	// edge and an end cell on the bottom edge. The mazes only depend on
+	// the seed (the std::mt19937_64 sequence is fixed by the standard, and
+	// no std distributions are used), so the same seed always gives the
+	// same maze, on any platform.
+	//
+	// A PERFECT maze is carved with an iterative recursive backtracker: it
+	// has exactly one path between any two cells, with long corridors and
+	// many dead ends. An OPEN_ROOMS maze starts as a perfect maze, then has
+	// rectangular rooms cut out of it and a share of its remaining inner
+	// walls knocked down, so it has many paths and large open areas.
+public:
+	maze_generator(unsigned long long seed = 1) : rng(seed) {
+		this->wall_char = '#';
+		this->path_char = '@';
+		this->start_char = '*';
+		this->end_char = 'x';
+	}
+
+	// Generate a maze of (about) 'width' x 'height' characters. Mazes are
+	// laid out on odd sizes, so an even width or height is rounded down,
+	// and are at least 3 x 3. Rows end in '\n'.
+	std::string generate(unsigned int width, unsigned int height, maze_style style);
+
+	// Generate a maze and write it to a file. Returns false if the file
+	// could not be written.
+	bool write(const std::string& path, unsigned int width, unsigned int height, maze_style style);
+
+	char wall_char;
+	char path_char;
+	char start_char;
+	char end_char;
+
+private:
+	// Random number below 'bound'
+	unsigned long long next(unsigned long long bound) { return this->rng() % bound; }
+
+	// Carve a perfect maze into 'maze' (rows of 'stride' characters)
+	void carve(std::string& maze, unsigned int cells_x, unsigned int cells_y, std::size_t stride);
+
+	// Cut rooms and knock down walls in a perfect maze
+	void open_rooms(std::string& maze, unsigned int cells_x, unsigned int cells_y, std::size_t stride);
+
+	std::mt19937_64 rng;
+};
+
+
+
+std::string maze_generator::generate(unsigned int width, unsigned int height, maze_style style) {
+	// Cell (x, y) is the character at (2x + 1, 2y + 1); the characters in
+	// between are walls that can be carved away
+	width = std::max(width, 3u);
+	height = std::max(height, 3u);
+	unsigned int cells_x = std::max(1u, (width - 1) / 2);
+	unsigned int cells_y = std::max(1u, (height - 1) / 2);
+	std::size_t columns = 2 * (std::size_t)cells_x + 1;
+	std::size_t rows = 2 * (std::size_t)cells_y + 1;
+	std::size_t stride = columns + 1;
+
+	std::string maze(stride * rows, this->wall_char);
+	for (std::size_t y = 0; y < rows; y++) {
+		maze[y * stride + columns] = '\n';
+	}
+
+	this->carve(maze, cells_x, cells_y, stride);
+	if (style == maze_style::OPEN_ROOMS) {
+		this->open_rooms(maze, cells_x, cells_y, stride);
+	}
+
+	// Open the start on the top edge and the end on the bottom edge
+	maze[2 * this->next(cells_x) + 1] = this->start_char;
+	maze[(rows - 1) * stride + 2 * this->next(cells_x) + 1] = this->end_char;
+	return maze;
+};
+
+
+
+bool maze_generator::write(const std::string& path, unsigned int width, unsigned int height, maze_style style) {
+	std::string maze = this->generate(width, height, style);
+	std::ofstream file(path, std::ios::binary);
+	if (!file) {
+		std::cerr << "Unable to open output file " << path << std::endl;
+		return false;
+	}
+	file.write(maze.data(), maze.size());
+	return (bool)file;
+};
+
+
+
+void maze_generator::carve(std::string& maze, unsigned int cells_x, unsigned int cells_y, std::size_t stride) {
+	std::size_t cells = (std::size_t)cells_x * cells_y;
+	std::vector<bool> visited(cells, false);
+	std::vector<unsigned int> stack;
+
+	// Position of a cell within the maze text
+	auto at = [&](std::size_t cell) {
+		return (2 * (cell / cells_x) + 1) * stride + 2 * (cell % cells_x) + 1;
+	};
+
+	unsigned int first = (unsigned int)this->next(cells);
+	visited[first] = true;
+	maze[at(first)] = this->path_char;
+	stack.push_back(first);
+
+	while (!stack.empty()) {
+		unsigned int cell = stack.back();
+		unsigned int x = cell % cells_x;
+		unsigned int y = cell / cells_x;
+
+		// Collect the unvisited neighbors, in the order left, right, up, down
+		unsigned int options[4];
+		unsigned int count = 0;
+		if (x > 0 && !visited[cell - 1]) options[count++] = cell - 1;
+		if (x + 1 < cells_x && !visited[cell + 1]) options[count++] = cell + 1;
+		if (y > 0 && !visited[cell - cells_x]) options[count++] = cell - cells_x;
+		if (y + 1 < cells_y && !visited[cell + cells_x]) options[count++] = cell + cells_x;
+
+		// Dead end: backtrack
+		if (count == 0) {
+			stack.pop_back();
+			continue;
+		}
+
+		// Carve into a random neighbor, and the wall in between
+		unsigned int next = options[this->next(count)];
+		visited[next] = true;
+		maze[at(next)] = this->path_char;
+		maze[(at(cell) + at(next)) / 2] = this->path_char;
+		stack.push_back(next);
+	}
+};
+
+
+
+void maze_generator::open_rooms(std::string& maze, unsigned int cells_x, unsigned int cells_y, std::size_t stride) {
+	// Largest room, in cells, and the share of inner walls knocked down
+	const unsigned int ROOM_SIZE = 8;
+	const unsigned int WALL_PERCENT = 10;
+
+	std::size_t columns = 2 * (std::size_t)cells_x + 1;
+	std::size_t rows = 2 * (std::size_t)cells_y + 1;
+
+	// One room for every 64 cells, each cleared of all inner walls
+	std::size_t rooms = (std::size_t)cells_x * cells_y / 64 + 1;
+	for (std::size_t r = 0; r < rooms; r++) {
+		unsigned int room_x = (unsigned int)this->next(std::min(cells_x, ROOM_SIZE)) + 1;
+		unsigned int room_y = (unsigned int)this->next(std::min(cells_y, ROOM_SIZE)) + 1;
+		unsigned int left = (unsigned int)this->next(cells_x - room_x + 1);
+		unsigned int top = (unsigned int)this->next(cells_y - room_y + 1);
+		for (std::size_t y = 2 * (std::size_t)top + 1; y < 2 * (std::size_t)(top + room_y); y++) {
+			for (std::size_t x = 2 * (std::size_t)left + 1; x < 2 * (std::size_t)(left + room_x); x++) {
+				maze[y * stride + x] = this->path_char;
+			}
+		}
+	}
+
+	// Knock down a share of the remaining walls between two cells (never
+	// the outer walls, and never the posts where four walls meet)
+	for (std::size_t y = 1; y + 1 < rows; y++) {
+		for (std::size_t x = 1 + (y % 2); x + 1 < columns; x += 2) {
+			if (maze[y * stride + x] == this->wall_char && this->next(100) < WALL_PERCENT) {
+				maze[y * stride + x] = this->path_char;
+			}
+		}
+	}
+};
+
+#endif